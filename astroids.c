@@ -1,495 +1,643 @@
 #include <math.h>
 #include <time.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 
 #include "sdl2-game-window.h"
 #include "primitives.h"
-#include "collision.h"
+#include "object-pool.h"
+#include "framebuffer.h"
+#include "job-system.h"
+#include "profiler.h"
+#include "replay.h"
+#include "world.h"
+
+#define HEADLESS_TICKS  100000
+#define HEADLESS_SEED   1
+#define HEADLESS_DELTA  (1.0 / 60.0)
+#define SIM_DELTA       (1.0 / 60.0)
+
+/*
+ * scripted input for headless runs. each step holds its keys for a
+ * number of ticks and the script loops forever.
+ */
+struct script_step
+{
+   int ticks;
+   char w, a, d, space;
+};
 
-#define SCREEN_WIDTH    1000
-#define SCREEN_HEIGHT   1000
+static const struct script_step script[] =
+{
+   { 60,  1, 0, 0, 1 },
+   { 30,  0, 1, 0, 1 },
+   { 90,  0, 0, 0, 1 },
+   { 20,  1, 0, 1, 0 },
+   { 45,  0, 0, 1, 1 },
+   { 120, 0, 0, 0, 1 },
+};
 
-#define MAX_OBJECTS     20
+// every line drawn in a frame, flushed in one call
+struct line_batch lines;
+Uint32 stats_time;
 
-#define SHIP_SIZE       20
-#define SHIP_SPEED      500
-#define SHIP_TURN_SPEED 5
+// f toggles filled astroids
+int fill_astroids;
+int fill_key;
 
-#define BULLET_SIZE     2
-#define BULLET_SPEED    600
-#define BULLET_INTERVAL 500
+// p toggles the frame time overlay
+int show_profiler;
+int profiler_key;
 
-#define ASTROIDS_SIZE   50
-#define ASTROIDS_SPEED  200
-#define ASTROIDS_SCALE  4
-#define ASTROIDS_MAX    5
-#define ASTROID_CHILDS  2
-#define ASTROIDS_START  2
+/*
+ * everything the render thread needs to draw a frame. the sim thread
+ * fills one after every step and hands it over, see
+ * start_game_threaded.
+ */
+struct world_snapshot
+{
+   struct object_pool astroids;
+   struct object_pool bullets;
+   struct polygon *ship;
+   struct polygon *thruster;
+   struct pose ship_pose, last_ship;
+   struct pose thruster_pose, last_thruster;
+   char thrust;
+   char fill;
+   char profiler;
+};
 
-#define PI              3.1415926535897932384626433832795
+struct world_snapshot snapshots[3];
 
-struct ship
+// the game being played or run headless
+struct world world;
+
+// astroids each game starts with, see world.swarm_size
+int swarm_size;
+
+// splits the per object loops of world_step, or the worlds of a batch, over worker threads
+struct job_system jobs;
+int job_threads;
+
+// independent worlds to run headless at once, 0 runs the one world
+int nworlds;
+
+void set_pose(struct polygon *p, struct pose pose)
 {
-   polygon *ship;
-   polygon *thruster;
-   struct { float x, y; } velocity;
-};
+   polygon_set_angle(p, pose.angle);
+   polygon_translate(p, pose.x, pose.y);
+}
 
-struct space_object
+struct pose lerp_pose(struct pose from, struct pose to, float alpha)
 {
-   polygon *shape;
-   struct { float x, y; } velocity;
-};
+   struct pose pose;
+
+   // a jump that big is a wrap around the screen, don't draw it sweeping across
+   if (fabsf(to.x - from.x) > SCREEN_WIDTH / 2 || fabsf(to.y - from.y) > SCREEN_HEIGHT / 2)
+      return to;
 
-int bullet_timer;
-int current_round;
-struct ship player;
-struct space_object *astroids[MAX_OBJECTS];
-struct space_object *bullets[MAX_OBJECTS];
+   pose.x = from.x + (to.x - from.x) * alpha;
+   pose.y = from.y + (to.y - from.y) * alpha;
+   pose.angle = from.angle + (to.angle - from.angle) * alpha;
+
+   return pose;
+}
 
-int wrap_position(float x, float y, float *ox, float *oy)
+// the live world seen as a snapshot, it shares the live memory
+struct world_snapshot live_world()
 {
-   if (x < 0)
-   {
-      if (ox != NULL)
-         *ox = SCREEN_WIDTH;
-      return 1;
-   }
+   struct world_snapshot w;
 
-   if (y < 0)
-   {
-      if (oy != NULL)
-         *oy = SCREEN_HEIGHT;
-      return 1;
-   }
+   w.astroids = world.astroids;
+   w.bullets = world.bullets;
+   w.ship = world.player.ship;
+   w.thruster = world.player.thruster;
+   w.thrust = world.player.thrust;
+   w.fill = fill_astroids;
+   w.profiler = 0;
 
-   if (x > SCREEN_WIDTH)
-   {
-      if (ox != NULL)
-         *ox = 0;
-      return 1;
-   }
+   return w;
+}
 
-   if (y > SCREEN_HEIGHT)
+int init_snapshots()
+{
+   for (int i = 0; i < 3; i++)
    {
-      if (oy != NULL)
-         *oy = 0;
-      return 1;
+      struct world_snapshot *w = &snapshots[i];
+
+      if (object_pool_init(&w->astroids, ASTROID_SIDES, POOL_START_SIZE) != 0 ||
+          object_pool_init(&w->bullets, BULLET_SIDES, POOL_START_SIZE) != 0)
+         return -1;
+
+      w->ship = create_copy_polygon(world.player.ship);
+      w->thruster = create_copy_polygon(world.player.thruster);
+
+      if (w->ship == NULL || w->thruster == NULL)
+         return -1;
    }
 
    return 0;
 }
 
-int add_astroid(float x, float y, float scale, int nadd)
+void free_snapshots()
 {
-   if (scale <= 0)
-      return -1;
-
-   if (nadd <= 0)
-      return 0;
-
-   int i, num, items;
-   for (i = 0, num = 0, items = 0; i < MAX_OBJECTS; i++)
+   for (int i = 0; i < 3; i++)
    {
-      if (astroids[i] == NULL)
-      {
-         astroids[i] = (struct space_object *)malloc(sizeof(struct space_object));
-         astroids[i]->shape = create_rand_polygon(24, x, y, (float)((double)rand() * (double)((2 * PI) / RAND_MAX)), ASTROIDS_SIZE, ASTROIDS_SIZE * 0.7f, 1);
-         astroids[i]->shape->scale.x = scale;
-         astroids[i]->shape->scale.y = scale;
-         astroids[i]->velocity.x = cos(astroids[i]->shape->angle) * (rand() % (int)(ASTROIDS_SPEED / scale));
-         astroids[i]->velocity.y = sin(astroids[i]->shape->angle) * (rand() % (int)(ASTROIDS_SPEED / scale));
-         polygon_rebuild(astroids[i]->shape);
-         num++;
-      }
-      else
-      {
-         items++;
-      }
-
-      if (num == nadd)
-         break;
+      object_pool_free(&snapshots[i].astroids);
+      object_pool_free(&snapshots[i].bullets);
+      free_polygon(snapshots[i].ship);
+      free_polygon(snapshots[i].thruster);
+      snapshots[i].ship = NULL;
+      snapshots[i].thruster = NULL;
    }
+}
 
-   // if full
-   if (items >= MAX_OBJECTS)
-      return -1;
+// copy the live world, only transforms move so vertices wait for the render thread
+void take_snapshot(struct world_snapshot *w)
+{
+   object_pool_copy(&w->astroids, &world.astroids);
+   object_pool_copy(&w->bullets, &world.bullets);
 
-   return 0;
+   w->ship_pose = get_pose(world.player.ship);
+   w->last_ship = world.player.last_ship;
+   w->thruster_pose = get_pose(world.player.thruster);
+   w->last_thruster = world.player.last_thruster;
+
+   set_pose(w->ship, w->ship_pose);
+   set_pose(w->thruster, w->thruster_pose);
+
+   w->thrust = world.player.thrust;
+   w->fill = fill_astroids;
+   w->profiler = show_profiler;
 }
 
-int add_astroid_rpos(float scale, int nadd)
+// move the snapshot polygons alpha of the way from the step before to its own
+void lerp_snapshot(struct world_snapshot *w, float alpha)
 {
-   if (scale <= 0)
-      return -1;
+   object_pool_lerp(&w->astroids, alpha);
+   object_pool_lerp(&w->bullets, alpha);
 
-   if (nadd <= 0)
-      return 0;
+   set_pose(w->ship, lerp_pose(w->last_ship, w->ship_pose, alpha));
+   set_pose(w->thruster, lerp_pose(w->last_thruster, w->thruster_pose, alpha));
+}
 
-   int i, num, items;
-   for (i = 0, num = 0, items = 0; i < MAX_OBJECTS; i++)
-   {
-      if (astroids[i] == NULL)
-      {
-         float x = rand() % SCREEN_WIDTH;
-         float y = rand() % SCREEN_HEIGHT;
+// queue every line of the frame into the batch
+void build_frame(struct world_snapshot *w)
+{
+   // every astroid and bullet gets drawn so build them in one batch
+   object_pool_update(&w->astroids);
+   object_pool_update(&w->bullets);
 
-         float angle;
+   lines.color = (SDL_Color){ 255, 255, 255, 255 };
 
-         // get x distance from player, y distance from player, and max diameter of an astroid.
-         float a = x - player.ship->x;
-         float b = y - player.ship->y;
-         float c = ASTROIDS_SIZE * ASTROIDS_SCALE * 2.0f;
+   // player ship
+   line_batch_polygon(&lines, w->ship);
+   line_batch_line(&lines, w->ship->x, w->ship->y, w->ship->vertices[0], w->ship->vertices[1]);
 
-         // check if astroid position is too close to player.
-         if (a * a + b * b < c * c)
-         {
-            angle = 1.0f / tan(b / a);
-            x = cos(angle) * ((float)ASTROIDS_SIZE * (float)ASTROIDS_SCALE * 2.0f) + player.ship->x;
-            y = sin(angle) * ((float)ASTROIDS_SIZE * (float)ASTROIDS_SCALE * 2.0f) + player.ship->y;
-            wrap_position(x, y, &x, &y);
-         }
+   // thruster
+   if (w->thrust)
+      line_batch_polygon(&lines, w->thruster);
 
-         astroids[i] = (struct space_object *)malloc(sizeof(struct space_object));
-         astroids[i]->shape = create_rand_polygon(24, x, y, (float)((double)rand() * (double)((2 * PI) / RAND_MAX)), ASTROIDS_SIZE, ASTROIDS_SIZE * 0.7f, 1);
-         astroids[i]->shape->scale.x = scale;
-         astroids[i]->shape->scale.y = scale;
-         astroids[i]->velocity.x = cos(astroids[i]->shape->angle) * (rand() % (int)(ASTROIDS_SPEED / scale));
-         astroids[i]->velocity.y = sin(astroids[i]->shape->angle) * (rand() % (int)(ASTROIDS_SPEED / scale));
-         polygon_rebuild(astroids[i]->shape);
-         num++;
-      }
+   // bullets and astroids
+   for (int i = 0; i < w->astroids.count; i++)
+   {
+      if (w->fill)
+         line_batch_polygon_filled(&lines, &w->astroids.shape[i]);
       else
-      {
-         items++;
-      }
-
-      if (num == nadd)
-         break;
+         line_batch_polygon(&lines, &w->astroids.shape[i]);
    }
 
-   // if full
-   if (items >= MAX_OBJECTS)
-      return -1;
+   for (int i = 0; i < w->bullets.count; i++)
+      line_batch_polygon(&lines, &w->bullets.shape[i]);
 
-   return 0;
+   if (w->profiler)
+      profiler_overlay(&profiler, &lines, 10, 10, 100);
 }
 
-int remove_astroid(int index)
+void draw_world(struct world_snapshot *w)
 {
-   if (index < 0 || index > MAX_OBJECTS)
-      return -1;
-
-   if (astroids[index] == NULL)
-      return -1;
+   profile_begin(PROFILE_RENDER);
+   clear_game_frame();
+   build_frame(w);
+
+   if (game.framebuffer != NULL)
+      framebuffer_batch(game.framebuffer, &lines);
+   else
+      line_batch_flush(game.renderer, &lines);
+   profile_end(PROFILE_RENDER);
+
+   // draw stats in the title once a second
+   if (SDL_GetTicks() - stats_time >= 1000)
+   {
+      char title[128];
 
-   free_polygon(astroids[index]->shape);
-   free(astroids[index]);
-   astroids[index] = NULL;
+      snprintf(title, sizeof(title), "astroids - %.0f fps, %d draw calls, %d vertices",
+            game.fps, lines.draw_calls, lines.drawn_vertices);
+      SDL_SetWindowTitle(game.window, title);
+      stats_time = SDL_GetTicks();
+   }
 
-   return 0;
+   SDL_SetRenderDrawColor(game.renderer, 0, 0, 0, 255);
+   present_game_frame();
 }
 
-int is_astroids_empty()
+// world_input that plays the script, the same for every world
+void script_input(struct world *w, void *data)
 {
-   for (int i = 0; i < MAX_OBJECTS; i++)
-      if (astroids[i] != NULL)
-         return 0;
+   (void)data;
+
+   int nsteps = sizeof(script) / sizeof(script[0]);
+   unsigned long length = 0;
+
+   for (int i = 0; i < nsteps; i++)
+      length += script[i].ticks;
 
-   return 1;
+   long t = w->tick % length;
+   int i = 0;
+
+   while (t >= script[i].ticks)
+      t -= script[i++].ticks;
+
+   w->keypress[SDL_SCANCODE_W] = script[i].w;
+   w->keypress[SDL_SCANCODE_A] = script[i].a;
+   w->keypress[SDL_SCANCODE_D] = script[i].d;
+   w->keypress[SDL_SCANCODE_SPACE] = script[i].space;
 }
 
-int add_bullet()
+// function needed for game window code
+int on_game_update()
 {
-   int i, items;
-   for (i = 0, items = 0; i < MAX_OBJECTS; i++)
+   memcpy(world.keypress, game.keypress, sizeof(world.keypress));
+
+   if (game.headless)
    {
-      if (bullets[i] == NULL)
-      {
-         bullets[i] = (struct space_object *)malloc(sizeof(struct space_object));
-         bullets[i]->shape = create_reg_polygon(6, player.ship->vertices[0], player.ship->vertices[1], player.ship->angle, BULLET_SIZE);
-         bullets[i]->velocity.x = cos(player.ship->angle) * (float)BULLET_SPEED;
-         bullets[i]->velocity.y = sin(player.ship->angle) * (float)BULLET_SPEED;
-         break;
-      }
-      else
-      {
-         items++;
-      }
+      // a replay already set the keys
+      if (game.replay == NULL)
+         script_input(&world, NULL);
+
+      world_step(&world, game.delta_t);
+      return 0;
    }
 
-   // is full
-   if (items >= MAX_OBJECTS)
-      return -1;
+   // f toggles filled astroids
+   if (game.keypress[SDL_SCANCODE_F] && !fill_key)
+      fill_astroids = !fill_astroids;
+   fill_key = game.keypress[SDL_SCANCODE_F];
+
+   // p toggles the frame time overlay
+   if (game.keypress[SDL_SCANCODE_P] && !profiler_key)
+      show_profiler = !show_profiler;
+   profiler_key = game.keypress[SDL_SCANCODE_P];
+
+   world_step(&world, game.delta_t);
+
+   // the render thread draws what gets handed over
+   if (game.threaded)
+   {
+      take_snapshot(&snapshots[game.snapshot_back]);
+      publish_game_snapshot();
+   }
 
    return 0;
 }
 
-int remove_bullet(int index)
+/*
+ * threaded mode draws the snapshot start_game_threaded picked, the
+ * single thread loop copies the live world first. either way it gets
+ * drawn game.alpha of the way from the step before.
+ */
+int on_game_render()
 {
-   if (index < 0 || index > MAX_OBJECTS)
-      return -1;
+   struct world_snapshot *w = &snapshots[game.snapshot_front];
 
-   if (bullets[index] == NULL)
-      return -1;
+   if (!game.threaded)
+   {
+      w = &snapshots[0];
+      take_snapshot(w);
+   }
 
-   free_polygon(bullets[index]->shape);
-   free(bullets[index]);
-   bullets[index] = NULL;
+   lerp_snapshot(w, game.alpha);
+   draw_world(w);
 
    return 0;
 }
 
-void restart_game()
+int on_game_creation()
 {
-   // reset player status
-   player.ship->x = SCREEN_WIDTH / 2.0f;
-   player.ship->y = SCREEN_HEIGHT / 2.0f;
-   player.velocity.x = 0;
-   player.velocity.y = 0;
-   polygon_rebuild(player.ship);
-
-   bullet_timer = 0;
-   current_round = 1;
-
-   // free bullets and astroids
-   for (int i = 0; i < MAX_OBJECTS; i++)
-   {
-      remove_bullet(i);
-      remove_astroid(i);
-   }
+   if (!game.headless)
+      SDL_ShowCursor(SDL_DISABLE);
+
+   job_system_init(&jobs, job_threads);
 
-   // init random astroids
-   int n = ASTROIDS_START > ASTROIDS_MAX ? ASTROIDS_MAX : ASTROIDS_START;
-   add_astroid_rpos(ASTROIDS_SCALE, n);
+   if (world_init(&world, game.seed, swarm_size) != 0)
+      return -1;
+
+   world.jobs = &jobs;
+   world.profile = 1;
+
+   // every snapshot starts out as the first frame
+   if (!game.headless && init_snapshots() == 0)
+      for (int i = 0; i < 3; i++)
+         take_snapshot(&snapshots[i]);
+
+   return 0;
 }
 
-void render_objects()
+/*
+ * rasterize the current state on the cpu and save it, lets headless
+ * runs be checked by eye
+ */
+int write_frame(const char *path)
 {
-   SDL_RenderClear(game.renderer);
-   SDL_SetRenderDrawColor(game.renderer, 255, 255, 255, 255);
+   struct framebuffer fb;
 
-   // draw player ship
-   draw_polygon(game.renderer, player.ship);
-   SDL_RenderDrawLineF(game.renderer, player.ship->x, player.ship->y, player.ship->vertices[0], player.ship->vertices[1]);
+   if (framebuffer_init(&fb, SCREEN_WIDTH, SCREEN_HEIGHT, 0) != 0)
+      return -1;
 
-   // draw thruster
-   if (game.keypress[SDLK_w])
-      draw_polygon(game.renderer, player.thruster);
+   struct world_snapshot w = live_world();
+   build_frame(&w);
+   framebuffer_batch(&fb, &lines);
+   framebuffer_render(&fb);
 
-   // draw bullets and astroids
-   for (int i = 0; i < MAX_OBJECTS; i++)
-   {
-      if(astroids[i] != NULL) draw_polygon(game.renderer, astroids[i]->shape);
-      if(bullets[i] != NULL) draw_polygon(game.renderer, bullets[i]->shape);
-   }
+   int ret = framebuffer_write_ppm(&fb, path);
+   framebuffer_free(&fb);
 
-   SDL_SetRenderDrawColor(game.renderer, 0, 0, 0, 255);
-   SDL_RenderPresent(game.renderer);
+   return ret;
 }
 
-void update_objects()
+/*
+ * run count worlds headless, seeded seed to seed + count - 1, split
+ * over the job system. each world plays the script on its own, the
+ * first one ends the same as a headless run with its seed. starts and
+ * quits SDL itself.
+ */
+int run_worlds(int count, unsigned long ticks, unsigned int seed)
 {
-   /*
-    * player ship stuff
-    */
+   if (SDL_Init(SDL_INIT_TIMER) != 0)
+      return -1;
 
-   // acceleration controls
-   if (game.keypress[SDLK_w])
-   {
-      // acceleration
-      player.velocity.x += cos(player.ship->angle) * (float)SHIP_SPEED * game.delta_t;
-      player.velocity.y += sin(player.ship->angle) * (float)SHIP_SPEED * game.delta_t;
-
-      /*
-       * note:
-       * I found this by accident but setting the thruster
-       * position before setting the player position gives a
-       * cool lag effect for the polygon giving a better
-       * feel for speed. This only works at lower fps.
-       */
-
-      // set thruster polygon stuff
-      player.thruster->angle = player.ship->angle + PI;
-      player.thruster->x = cos(player.thruster->angle) * (float)SHIP_SIZE + player.ship->x;
-      player.thruster->y = sin(player.thruster->angle) * (float)SHIP_SIZE + player.ship->y;
-      polygon_rebuild(player.thruster);
-   }
+   int ret = -1;
+   int ninit = 0;
+   struct world *worlds = (struct world *)malloc(sizeof(struct world) * count);
 
-   // turn controls
-   if (game.keypress[SDLK_a])
+   if (worlds != NULL)
    {
-      player.ship->angle -= (float)SHIP_TURN_SPEED * game.delta_t;
+      while (ninit < count && world_init(&worlds[ninit], seed + ninit, swarm_size) == 0)
+         ninit++;
    }
 
-   if (game.keypress[SDLK_d])
+   if (worlds != NULL && ninit == count)
    {
-      player.ship->angle += (float)SHIP_TURN_SPEED * game.delta_t;
-   }
+      job_system_init(&jobs, job_threads);
 
-   // give player drag to simulate speed limit
-   player.velocity.x -= player.velocity.x * game.delta_t;
-   player.velocity.y -= player.velocity.y * game.delta_t;
+      Uint64 start = SDL_GetPerformanceCounter();
+      world_batch(&jobs, worlds, count, ticks, HEADLESS_DELTA, script_input, NULL);
+      Uint64 end = SDL_GetPerformanceCounter();
 
-   // move ship
-   player.ship->x += player.velocity.x * game.delta_t;
-   player.ship->y += player.velocity.y * game.delta_t;
+      double seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+      double total = (double)ticks * count;
 
-   // wrap ship around screen
-   wrap_position(player.ship->x, player.ship->y, &player.ship->x, &player.ship->y);
+      printf("worlds: %d worlds on %d threads, %.0f ticks in %.3f s (%.0f ticks/s)\n",
+            count, jobs.nworkers, total, seconds, seconds > 0 ? total / seconds : 0);
 
-   polygon_rebuild(player.ship);
+      // sums so batches can be compared between runs
+      long rounds = 0;
+      long nastroids = 0;
 
-   /*
-    * bullet stuff
-    */
-
-   // shoot bullet
-   if (game.keypress[SDLK_SPACE])
-   {
-      // set first avalible space in array for bullet
-      if (bullet_timer <= 0)
+      for (int i = 0; i < count; i++)
       {
-         add_bullet();
-         bullet_timer = BULLET_INTERVAL;
+         rounds += worlds[i].current_round;
+         nastroids += worlds[i].astroids.count;
       }
+
+      printf("worlds: %ld rounds, %ld astroids\n", rounds, nastroids);
+      printf("headless: round %d, %d astroids, ship at (%.2f, %.2f)\n",
+            worlds[0].current_round, worlds[0].astroids.count, worlds[0].player.ship->x, worlds[0].player.ship->y);
+
+      ret = 0;
    }
 
-   // move all bullets
-   for (int i = 0; i < MAX_OBJECTS; i++)
+   // every way out cleans up the same, a world that failed half way still has parts to free
+   if (worlds != NULL)
    {
-      if (bullets[i] != NULL)
-      {
-         bullets[i]->shape->x += bullets[i]->velocity.x * game.delta_t;
-         bullets[i]->shape->y += bullets[i]->velocity.y * game.delta_t;
+      for (int i = 0; i < count && i <= ninit; i++)
+         world_free(&worlds[i]);
 
-         polygon_rebuild(bullets[i]->shape);
-
-         // remove bullet that reached edge of space
-         if (wrap_position(bullets[i]->shape->x, bullets[i]->shape->y, NULL, NULL))
-            remove_bullet(i);
-      }
+      free(worlds);
    }
 
-   // reduce timer
-   if (bullet_timer > 0) bullet_timer -= game.delta_t * 1000.0f;
+   job_system_free(&jobs);
+   polygon_pool_release();
+   SDL_Quit();
+
+   return ret;
+}
+
+static const char *pacing_names[] = { "sleep", "vsync", "uncapped" };
+
+// GAME_PACE_* by name, -1 for none
+static int pacing_mode(const char *name)
+{
+   for (int i = 0; i < (int)(sizeof(pacing_names) / sizeof(pacing_names[0])); i++)
+      if (strcmp(name, pacing_names[i]) == 0)
+         return i;
+
+   return -1;
+}
+
+/*
+ * usage:
+ * astroids [--software] [--single-thread] [--pacing mode] [--jobs n] [--profile file] [--record file | --replay file]
+ * astroids --headless [ticks] [seed] [swarm size] [frame.ppm] [--jobs n] [--profile file] [--replay file]
+ * astroids --headless [ticks] [seed] [swarm size] --worlds n [--jobs n]
+ *
+ * --pacing is sleep (default), vsync or uncapped, see GAME_PACE_*
+ * --jobs sets the update worker threads, 0 is one per cpu
+ * --worlds runs n games at once, the worker threads take whole games
+ * --profile saves the frame times on exit, as json for a .json file
+ * --record saves the input of a game, --replay plays it back as fast
+ * as possible. a headless replay takes its ticks, seed and swarm size
+ * from the file.
+ */
+int main(int argc, char **argv)
+{
+   int render = GAME_RENDER_SDL;
+   int pacing = GAME_PACE_SLEEP;
+   int threaded = 1;
+
+   // arguments that aren't flags, in order
+   char *args[5] = { NULL };
+   int nargs = 0;
+   char *profile_path = NULL;
+   char *record_path = NULL;
+   char *replay_path = NULL;
+   struct replay replay;
 
-   /*
-    * astroids stuff
-    */
+   job_threads = 0;
 
-   // move all astroids
-   for (int i = 0; i < MAX_OBJECTS; i++)
+   // before the job system and sim thread start transforming polygons
+   primitives_init();
+
+   for (int i = 1; i < argc; i++)
    {
-      if (astroids[i] != NULL)
+      if (strcmp(argv[i], "--software") == 0)
+         render = GAME_RENDER_FRAMEBUFFER;
+      else if (strcmp(argv[i], "--single-thread") == 0)
+         threaded = 0;
+      else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc)
       {
-         astroids[i]->shape->x += astroids[i]->velocity.x * game.delta_t;
-         astroids[i]->shape->y += astroids[i]->velocity.y * game.delta_t;
-
-         // wrap astroids around screen
-         wrap_position(astroids[i]->shape->x, astroids[i]->shape->y, &astroids[i]->shape->x, &astroids[i]->shape->y);
+         pacing = pacing_mode(argv[++i]);
 
-         polygon_rebuild(astroids[i]->shape);
+         if (pacing < 0)
+         {
+            printf("unknown pacing %s, use sleep, vsync or uncapped\n", argv[i]);
+            return 1;
+         }
       }
+      else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+         job_threads = atoi(argv[++i]);
+      else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+         profile_path = argv[++i];
+      else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+         record_path = argv[++i];
+      else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+         replay_path = argv[++i];
+      else if (strcmp(argv[i], "--worlds") == 0 && i + 1 < argc)
+         nworlds = atoi(argv[++i]);
+      else if (nargs < 5)
+         args[nargs++] = argv[i];
    }
 
-   /*
-    * collision detection
-    */
+   if (nworlds > 0)
+   {
+      if (nargs == 0 || strcmp(args[0], "--headless") != 0)
+      {
+         printf("--worlds only runs headless\n");
+         return 1;
+      }
+
+      if (replay_path != NULL || record_path != NULL || profile_path != NULL || nargs > 4)
+         printf("worlds: every world plays the script, --replay, --record, --profile and frames are ignored\n");
+
+      unsigned long ticks = nargs > 1 ? strtoul(args[1], NULL, 10) : HEADLESS_TICKS;
+      unsigned int seed = nargs > 2 ? strtoul(args[2], NULL, 10) : HEADLESS_SEED;
+      swarm_size = nargs > 3 ? atoi(args[3]) : 0;
+
+      return run_worlds(nworlds, ticks, seed) == 0 ? 0 : 1;
+   }
 
-   // check player astroid collision
-   for (int i = 0; i < MAX_OBJECTS; i++)
+   if (replay_path != NULL)
    {
-      if (astroids[i] != NULL && polygon_polygon_collision(player.ship->vertices, player.ship->nsides, astroids[i]->shape->vertices, astroids[i]->shape->nsides))
+      if (replay_play(&replay, replay_path) != 0)
       {
-         restart_game();
+         printf("could not play %s\n", replay_path);
+         return 1;
       }
+
+      game.replay = &replay;
+      swarm_size = replay.header.user[0];
    }
 
-   // check bullet astroid collision
-   for (int i = 0; i < MAX_OBJECTS; i++)
+   if (nargs > 0 && strcmp(args[0], "--headless") == 0)
    {
-      if (bullets[i] == NULL)
-         continue;
+      unsigned long ticks = nargs > 1 ? strtoul(args[1], NULL, 10) : HEADLESS_TICKS;
+      unsigned int seed = nargs > 2 ? strtoul(args[2], NULL, 10) : HEADLESS_SEED;
+      swarm_size = nargs > 3 ? atoi(args[3]) : 0;
+
+      // the keys come from a script, there is nothing to record
+      if (record_path != NULL)
+         printf("headless: --record needs a window, ignored\n");
 
-      // check bullet (i) with astroid (j)
-      for (int j = 0; j < MAX_OBJECTS; j++)
+      if (game.replay != NULL)
       {
-         if (astroids[j] == NULL)
-            continue;
+         ticks = ULONG_MAX;
+         seed = replay.header.seed;
+         swarm_size = replay.header.user[0];
+      }
 
-         if (point_polygon_collision(bullets[i]->shape->x, bullets[i]->shape->y, astroids[j]->shape->vertices, astroids[j]->shape->nsides))
-         {
-            float x = astroids[j]->shape->x;
-            float y = astroids[j]->shape->y;
-            float scale = (astroids[j]->shape->scale.x - (astroids[j]->shape->scale.x / 2.0f));
+      if (init_game_headless(SCREEN_WIDTH, SCREEN_HEIGHT, seed) != 0)
+         return 1;
 
-            // remove bullet and astroid stuff
-            remove_bullet(i);
-            remove_astroid(j);
+      // timers only run when asked for so they don't skew ticks/s
+      profiler.enabled = profile_path != NULL;
 
-            // create two smaller astroids
-            if (scale >= ASTROIDS_SCALE / 4.0f)
-               add_astroid(x, y, scale, ASTROID_CHILDS);
+      start_game_headless(ticks, HEADLESS_DELTA);
 
-            // break after collision because the bullet no longer exists
-            break;
-         }
-      }
-   }
+      // final state so runs with the same seed can be compared
+      printf("headless: round %d, %d astroids, ship at (%.2f, %.2f)\n",
+            world.current_round, world.astroids.count, world.player.ship->x, world.player.ship->y);
 
-   // add more astroids if there are no more astroids
-   if (is_astroids_empty())
-   {
-      current_round++;
-      int n = current_round + ASTROIDS_START - 1 > ASTROIDS_MAX ? ASTROIDS_MAX : current_round + ASTROIDS_START - 1;
-      add_astroid_rpos(ASTROIDS_SCALE, n);
+      if (nargs > 4 && write_frame(args[4]) != 0)
+         printf("headless: could not write %s\n", args[4]);
    }
-}
+   else
+   {
+      // replays play as fast as they can
+      if (game.replay != NULL)
+         pacing = GAME_PACE_UNCAPPED;
 
-// function needed for game window code
-int on_game_update()
-{
-   update_objects();
-   render_objects();
+      if (init_game_window(SCREEN_WIDTH, SCREEN_HEIGHT, "astroids", render, pacing) != 0)
+         return 1;
 
-   return 0;
-}
+      if (game.pacing != pacing)
+         printf("pacing: no vsync from the renderer, pacing by sleep\n");
 
-int on_game_creation()
-{
-   SDL_ShowCursor(SDL_DISABLE);
-   srand(SDL_GetTicks());
+      profiler.enabled = 1;
 
-   // init player
-   player.ship = create_reg_polygon(3, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, 0, SHIP_SIZE);
-   player.thruster = create_reg_polygon(3, 0, 0, 0, (float)SHIP_SIZE / 2.0f);
-   player.velocity.x = 0;
-   player.velocity.y = 0;
+      if (record_path != NULL && game.replay == NULL)
+      {
+         struct replay_header header = { game.seed, SIM_DELTA, { swarm_size } };
 
-   bullet_timer = 0;
-   current_round = 1;
+         if (replay_record(&replay, record_path, &header) == 0)
+            game.replay = &replay;
+         else
+            printf("could not record %s\n", record_path);
+      }
 
-   // init bullets and astroids
-   for (int i = 0; i < MAX_OBJECTS; i++)
-   {
-      bullets[i] = NULL;
-      astroids[i] = NULL;
-   }
+      if (game.replay != NULL && game.replay->mode == REPLAY_PLAY)
+         start_game_replay();
+      else if (threaded)
+         start_game_threaded(SIM_DELTA);
+      else
+         start_game(SIM_DELTA);
 
-   restart_game();
+      // final state so a recording and its replay can be compared
+      if (game.replay != NULL)
+         printf("%s: %lu ticks, round %d, %d astroids, ship at (%.2f, %.2f)\n",
+               game.replay->mode == REPLAY_PLAY ? "replay" : "record", game.tick,
+               world.current_round, world.astroids.count, world.player.ship->x, world.player.ship->y);
 
-   return 0;
-}
+      // time from a key change to the first frame that shows it
+      float median, p99, max;
+      int n = profiler_input_stats(&profiler, &median, &p99, &max);
 
-int main()
-{
-   init_game_window(SCREEN_WIDTH, SCREEN_HEIGHT, "astroids");
-   start_game();
+      if (n > 0)
+         printf("input: %d frames, input to photon median %.1f ms, p99 %.1f ms, max %.1f ms\n", n, median, p99, max);
+
+      // how steady the pacing mode was
+      float jitter;
+      n = profiler_frame_stats(&profiler, &median, &p99, &max, &jitter);
+
+      if (n > 0)
+         printf("frames: %d frames paced by %s, median %.2f ms, p99 %.2f ms, max %.2f ms, jitter %.2f ms\n",
+               n, pacing_names[game.pacing], median, p99, max, jitter);
+   }
+
+   if (game.replay != NULL && replay_close(game.replay) != 0 && game.replay->mode == REPLAY_RECORD)
+      printf("could not save %s\n", record_path);
+
+   if (profile_path != NULL && profiler_write(&profiler, profile_path) != 0)
+      printf("could not write %s\n", profile_path);
 
    // return memory stuff
    close_game_window();
-   free_polygon(player.ship);
+   job_system_free(&jobs);
+   world_free(&world);
+   free_snapshots();
+   polygon_pool_release();
+   line_batch_free(&lines);
 
    return 0;
 }
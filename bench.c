@@ -0,0 +1,908 @@
+/*
+ * Description:
+ * Micro benchmarks for the primitives and collision code
+ *
+ * every kernel runs a few warmup repetitions and then BENCH_REPS timed
+ * ones, the median and p99 time per item are reported. --csv and
+ * --json also save the results for comparing between commits.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "primitives.h"
+#include "collision.h"
+#include "framebuffer.h"
+#include "fast-math.h"
+
+// set by the makefile, results are only comparable between builds with the same flags
+#ifndef BENCH_CFLAGS
+#define BENCH_CFLAGS    "unknown"
+#endif
+
+#define BENCH_WARMUP    3
+#define BENCH_REPS      31
+#define BENCH_RESULTS   128
+
+#define BENCH_POINTS    4096
+#define BENCH_PAIRS     512
+#define BENCH_FILLS     256
+#define BENCH_CREATES   1024
+#define BENCH_ANGLES    4096
+
+struct point
+{
+   float x, y;
+};
+
+// one repetition, handles every item once
+typedef void (*bench_func)(void *data);
+
+// times are nanoseconds per item
+struct bench_result
+{
+   char name[48];
+   int nsides;
+   int count;
+   double median;
+   double p99;
+   double min;
+};
+
+static struct bench_result results[BENCH_RESULTS];
+static int nresults;
+
+static double seconds_since(Uint64 start)
+{
+   return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+static int dblcmp(const void *a, const void *b)
+{
+   double d = *(const double *)a - *(const double *)b;
+   return (d > 0) - (d < 0);
+}
+
+// time func over count items and print a row
+static void bench_run(const char *name, int nsides, int count, bench_func func, void *data)
+{
+   double times[BENCH_REPS];
+
+   for (int r = 0; r < BENCH_WARMUP; r++)
+      func(data);
+
+   for (int r = 0; r < BENCH_REPS; r++)
+   {
+      Uint64 start = SDL_GetPerformanceCounter();
+      func(data);
+      times[r] = seconds_since(start) * 1e9 / count;
+   }
+
+   qsort(times, BENCH_REPS, sizeof(double), dblcmp);
+
+   struct bench_result result;
+
+   snprintf(result.name, sizeof(result.name), "%s", name);
+   result.nsides = nsides;
+   result.count = count;
+   result.median = times[BENCH_REPS / 2];
+   result.p99 = times[(BENCH_REPS * 99 + 99) / 100 - 1];
+   result.min = times[0];
+
+   printf("%-36s %4d sides %6d items  median %10.1f ns  p99 %10.1f ns  %12.0f items/s\n",
+         name, nsides, count, result.median, result.p99, 1e9 / result.median);
+
+   if (nresults < BENCH_RESULTS)
+      results[nresults++] = result;
+}
+
+/*
+ * point_polygon_collision as it was before it stopped allocating:
+ * malloc a crossing list, qsort it and look for a pair around x.
+ * kept here so the benchmark has something to compare against. the
+ * old compare function cast the difference to int which misordered
+ * crossings less than a pixel apart, this one doesn't.
+ */
+static int legacy_fpolycmp(const void *a, const void *b)
+{
+   float d = *(float *)a - *(float *)b;
+   return (d > 0) - (d < 0);
+}
+
+static int legacy_point_polygon_collision(float x, float y, const float *polygon, int nsides)
+{
+   struct point *points = (struct point *)polygon;
+
+   float max_y = points[0].y;
+
+   for (int i = 0; i < nsides; i ++)
+      max_y = points[i].y > max_y ? points[i].y : max_y;
+
+   int nint = 0;
+   float *nodes_x = (float *)malloc(sizeof(float) * nsides);
+
+   for (int i = 0; i < nsides; i++)
+   {
+      int ind1 = i == 0 ? nsides - 1 : i - 1;
+      int ind2 = i;
+      float x1, y1, x2, y2;
+
+      y1 = points[ind1].y;
+      y2 = points[ind2].y;
+      if (y1 < y2) {
+         x1 = points[ind1].x;
+         x2 = points[ind2].x;
+      } else if (y1 > y2) {
+         y2 = points[ind1].y;
+         y1 = points[ind2].y;
+         x2 = points[ind1].x;
+         x1 = points[ind2].x;
+      } else {
+         continue;
+      }
+      if ( ((y >= y1) && (y < y2)) || ((y == max_y) && (y > y1) && (y <= y2)) )
+         nodes_x[nint++] = (y - y1) * (x2 - x1) / (y2 - y1) + x1;
+   }
+
+   qsort(nodes_x, nint, sizeof(float), legacy_fpolycmp);
+
+   int hit = 0;
+   if (nint % 2 == 0)
+      for (int k = 0; k < nint && !hit; k += 2)
+         hit = x > nodes_x[k] && x < nodes_x[k + 1];
+
+   free(nodes_x);
+
+   return hit;
+}
+
+// random points inside the bounds of p
+static void random_points(const struct polygon *p, struct point *points, int n)
+{
+   for (int i = 0; i < n; i++)
+   {
+      points[i].x = p->bounds.min_x + (p->bounds.max_x - p->bounds.min_x) * rand() / (float)RAND_MAX;
+      points[i].y = p->bounds.min_y + (p->bounds.max_y - p->bounds.min_y) * rand() / (float)RAND_MAX;
+   }
+}
+struct point_bench
+{
+   struct polygon *p;
+   struct point points[BENCH_POINTS];
+   int hits;
+};
+
+static void run_point_legacy(void *data)
+{
+   struct point_bench *b = (struct point_bench *)data;
+
+   for (int i = 0; i < BENCH_POINTS; i++)
+      b->hits += legacy_point_polygon_collision(b->points[i].x, b->points[i].y, b->p->vertices, b->p->nsides);
+}
+
+static void run_point(void *data)
+{
+   struct point_bench *b = (struct point_bench *)data;
+
+   for (int i = 0; i < BENCH_POINTS; i++)
+      b->hits += point_polygon_collision(b->points[i].x, b->points[i].y, b->p);
+}
+
+// a bullet's path in one step at 60 fps
+static void run_segment(void *data)
+{
+   struct point_bench *b = (struct point_bench *)data;
+
+   for (int i = 0; i < BENCH_POINTS; i++)
+      b->hits += segment_polygon_collision(b->points[i].x, b->points[i].y, b->points[i].x + 7, b->points[i].y + 7, b->p, NULL);
+}
+
+static void bench_point_polygon_collision(int nsides)
+{
+   struct point_bench *b = (struct point_bench *)malloc(sizeof(struct point_bench));
+
+   b->p = create_rand_polygon(nsides, 500, 500, 0.3f, 50, 35, 1);
+   b->hits = 0;
+   random_points(b->p, b->points, BENCH_POINTS);
+
+   int mismatches = 0;
+   int segment_mismatches = 0;
+
+   for (int i = 0; i < BENCH_POINTS; i++)
+   {
+      int x = legacy_point_polygon_collision(b->points[i].x, b->points[i].y, b->p->vertices, b->p->nsides);
+      int y = point_polygon_collision(b->points[i].x, b->points[i].y, b->p);
+      mismatches += x != y;
+
+      // a segment of no length is the point test
+      segment_mismatches += y != segment_polygon_collision(b->points[i].x, b->points[i].y, b->points[i].x, b->points[i].y, b->p, NULL);
+   }
+
+   bench_run("legacy_point_polygon_collision", nsides, BENCH_POINTS, run_point_legacy, b);
+   bench_run("point_polygon_collision", nsides, BENCH_POINTS, run_point, b);
+   bench_run("segment_polygon_collision", nsides, BENCH_POINTS, run_segment, b);
+
+   if (mismatches > 0)
+      printf("   %d of %d points disagree with the legacy version\n", mismatches, BENCH_POINTS);
+
+   if (segment_mismatches > 0)
+      printf("   %d of %d empty segments disagree with the point test\n", segment_mismatches, BENCH_POINTS);
+
+   free_polygon(b->p);
+   free(b);
+}
+
+/*
+ * polygon_polygon_collision as it was before the separating axis test,
+ * only checks for vertices inside the other polygon.
+ */
+static int legacy_polygon_polygon_collision(const struct polygon *p1, const struct polygon *p2)
+{
+   struct point *points1 = (struct point *)p1->vertices;
+   struct point *points2 = (struct point *)p2->vertices;
+
+   for (int i = 0; i < p1->nsides; i++)
+      if (legacy_point_polygon_collision(points1[i].x, points1[i].y, p2->vertices, p2->nsides))
+         return 1;
+
+   for (int i = 0; i < p2->nsides; i++)
+      if (legacy_point_polygon_collision(points2[i].x, points2[i].y, p1->vertices, p1->nsides))
+         return 1;
+
+   return 0;
+}
+
+struct pair_bench
+{
+   struct polygon *a[BENCH_PAIRS];
+   struct polygon *b[BENCH_PAIRS];
+   int hits;
+};
+
+static void run_pairs_legacy(void *data)
+{
+   struct pair_bench *b = (struct pair_bench *)data;
+
+   for (int i = 0; i < BENCH_PAIRS; i++)
+      b->hits += legacy_polygon_polygon_collision(b->a[i], b->b[i]);
+}
+
+static void run_pairs(void *data)
+{
+   struct pair_bench *b = (struct pair_bench *)data;
+
+   for (int i = 0; i < BENCH_PAIRS; i++)
+      b->hits += polygon_polygon_collision(b->a[i], b->b[i]);
+}
+
+static void bench_polygon_polygon_collision(int nsides1, int nsides2)
+{
+   struct pair_bench *b = (struct pair_bench *)malloc(sizeof(struct pair_bench));
+
+   // pairs close enough that bounding circles mostly overlap
+   for (int i = 0; i < BENCH_PAIRS; i++)
+   {
+      float angle = 2.0f * 3.14159265f * rand() / (float)RAND_MAX;
+      float distance = 100.0f * rand() / (float)RAND_MAX;
+
+      b->a[i] = nsides1 == 3 ? create_reg_polygon(3, 500, 500, angle, 20) : create_rand_polygon(nsides1, 500, 500, angle, 50, 35, 1);
+      b->b[i] = create_rand_polygon(nsides2, 500 + cosf(angle) * distance, 500 + sinf(angle) * distance, -angle, 50, 35, 1);
+   }
+
+   // the new test also finds edges crossing, it must find everything the old one did
+   int missed = 0;
+   for (int i = 0; i < BENCH_PAIRS; i++)
+      missed += legacy_polygon_polygon_collision(b->a[i], b->b[i]) && !polygon_polygon_collision(b->a[i], b->b[i]);
+
+   if (missed > 0)
+      printf("   %d of %d pairs the legacy version hits are missed\n", missed, BENCH_PAIRS);
+
+   char name[48];
+
+   snprintf(name, sizeof(name), "legacy_polygon_polygon_collision_%d", nsides1);
+   bench_run(name, nsides2, BENCH_PAIRS, run_pairs_legacy, b);
+
+   snprintf(name, sizeof(name), "polygon_polygon_collision_%d", nsides1);
+   bench_run(name, nsides2, BENCH_PAIRS, run_pairs, b);
+
+   for (int i = 0; i < BENCH_PAIRS; i++)
+   {
+      free_polygon(b->a[i]);
+      free_polygon(b->b[i]);
+   }
+
+   free(b);
+}
+
+// polygon_rebuild as it was before the float kernels, double sin and cos per vertex
+static void legacy_polygon_rebuild(struct polygon *p)
+{
+   struct point *vectors = (struct point *)p->vectors;
+   struct point *vertices = (struct point *)p->vertices;
+
+   for (int i = 0; i < p->nsides; i++)
+   {
+      vertices[i].x = (float)(p->x + p->scale.x * ((vectors[i].x * cos(p->angle)) - (vectors[i].y * sin(p->angle))));
+      vertices[i].y = (float)(p->y + p->scale.y * ((vectors[i].x * sin(p->angle)) + (vectors[i].y * cos(p->angle))));
+   }
+}
+
+struct rebuild_bench
+{
+   struct polygon *a, *b;
+   int count;
+};
+
+static void run_rebuild_legacy(void *data)
+{
+   struct rebuild_bench *b = (struct rebuild_bench *)data;
+
+   for (int i = 0; i < b->count; i++)
+      legacy_polygon_rebuild(&b->a[i]);
+}
+
+static void run_rebuild(void *data)
+{
+   struct rebuild_bench *b = (struct rebuild_bench *)data;
+
+   polygons_rebuild(b->b, b->count);
+}
+
+// items are polygons, not vertices
+static void bench_polygons_rebuild(int nsides, int count)
+{
+   struct rebuild_bench bench = { NULL, NULL, count };
+   struct polygon *a = (struct polygon *)malloc(sizeof(struct polygon) * count);
+   struct polygon *b = (struct polygon *)malloc(sizeof(struct polygon) * count);
+   float *vectors = (float *)malloc(sizeof(float) * count * nsides * 2);
+   float *vertices_a = (float *)malloc(sizeof(float) * count * nsides * 2);
+   float *vertices_b = (float *)malloc(sizeof(float) * count * nsides * 2);
+   int *hull = (int *)malloc(sizeof(int) * count * nsides);
+
+   for (int i = 0; i < count; i++)
+   {
+      float *v = vectors + i * nsides * 2;
+      rand_polygon_vectors(v, nsides, 50, 35, 1);
+
+      float angle = 6.2831853f * rand() / (float)RAND_MAX;
+      float x = 1000.0f * rand() / (float)RAND_MAX;
+      float y = 1000.0f * rand() / (float)RAND_MAX;
+
+      init_polygon(&a[i], v, vertices_a + i * nsides * 2, NULL, hull + i * nsides, nsides, x, y, angle);
+      init_polygon(&b[i], v, vertices_b + i * nsides * 2, NULL, hull + i * nsides, nsides, x, y, angle);
+      a[i].scale.x = b[i].scale.x = 0.5f + 4.0f * rand() / (float)RAND_MAX;
+      a[i].scale.y = b[i].scale.y = a[i].scale.x;
+   }
+
+   bench.a = a;
+   bench.b = b;
+
+   bench_run("legacy_polygon_rebuild", nsides, count, run_rebuild_legacy, &bench);
+   bench_run("polygons_rebuild", nsides, count, run_rebuild, &bench);
+
+   float error = 0;
+   for (int i = 0; i < count * nsides * 2; i++)
+      error = fabsf(vertices_a[i] - vertices_b[i]) > error ? fabsf(vertices_a[i] - vertices_b[i]) : error;
+
+   if (error > 0.01f)
+      printf("   max error against the legacy version %g\n", error);
+
+   free(a);
+   free(b);
+   free(vectors);
+   free(vertices_a);
+   free(vertices_b);
+   free(hull);
+}
+
+struct move_bench
+{
+   struct polygon *p;
+   int count;
+   float step;
+};
+
+// what every astroid does each step, move and then get read
+static void run_moved(void *data)
+{
+   struct move_bench *b = (struct move_bench *)data;
+
+   b->step = -b->step;
+   for (int i = 0; i < b->count; i++)
+      polygon_translate(&b->p[i], b->p[i].x + b->step, b->p[i].y);
+
+   polygons_update(b->p, b->count);
+}
+
+// the same with a turn, which builds the vertices in full
+static void run_turned(void *data)
+{
+   struct move_bench *b = (struct move_bench *)data;
+
+   b->step = -b->step;
+   for (int i = 0; i < b->count; i++)
+   {
+      polygon_translate(&b->p[i], b->p[i].x + b->step, b->p[i].y);
+      polygon_set_angle(&b->p[i], b->p[i].angle + b->step);
+   }
+
+   polygons_update(b->p, b->count);
+}
+
+// items are polygons, moving only adds the position to the offsets
+static void bench_polygons_moved(int nsides, int count)
+{
+   struct move_bench bench = { NULL, count, 0.5f };
+   struct polygon *p = (struct polygon *)malloc(sizeof(struct polygon) * count);
+   float *vectors = (float *)malloc(sizeof(float) * count * nsides * 2);
+   float *vertices = (float *)malloc(sizeof(float) * count * nsides * 2);
+   float *offsets = (float *)malloc(sizeof(float) * count * nsides * 2);
+   int *hull = (int *)malloc(sizeof(int) * count * nsides);
+
+   for (int i = 0; i < count; i++)
+   {
+      float *v = vectors + i * nsides * 2;
+      rand_polygon_vectors(v, nsides, 50, 35, 1);
+
+      init_polygon(&p[i], v, vertices + i * nsides * 2, offsets + i * nsides * 2, hull + i * nsides, nsides,
+            1000.0f * rand() / (float)RAND_MAX, 1000.0f * rand() / (float)RAND_MAX, 6.2831853f * rand() / (float)RAND_MAX);
+   }
+
+   bench.p = p;
+
+   bench_run("polygons_update_turned", nsides, count, run_turned, &bench);
+   bench_run("polygons_update_moved", nsides, count, run_moved, &bench);
+
+   // moving has to give the same vertices as building them in full
+   int mismatches = 0;
+   float *built = (float *)malloc(sizeof(float) * nsides * 2);
+
+   for (int i = 0; i < count; i++)
+   {
+      memcpy(built, p[i].vertices, sizeof(float) * nsides * 2);
+      polygon_rebuild(&p[i]);
+      mismatches += memcmp(built, p[i].vertices, sizeof(float) * nsides * 2) != 0;
+   }
+
+   if (mismatches > 0)
+      printf("   %d of %d moved polygons differ from a full build\n", mismatches, count);
+
+   free(built);
+   free(p);
+   free(vectors);
+   free(vertices);
+   free(offsets);
+   free(hull);
+}
+
+struct create_bench
+{
+   struct polygon *p[BENCH_CREATES];
+   int nsides;
+};
+
+// pooled blocks get reused, so this is create and free together
+static void run_create(void *data)
+{
+   struct create_bench *b = (struct create_bench *)data;
+
+   for (int i = 0; i < BENCH_CREATES; i++)
+      b->p[i] = create_rand_polygon(b->nsides, 500, 500, 0.3f * i, 50, 35, 1);
+
+   for (int i = 0; i < BENCH_CREATES; i++)
+      free_polygon(b->p[i]);
+}
+
+static void bench_create_rand_polygon(int nsides)
+{
+   struct create_bench *b = (struct create_bench *)malloc(sizeof(struct create_bench));
+
+   b->nsides = nsides;
+   bench_run("create_rand_polygon", nsides, BENCH_CREATES, run_create, b);
+
+   free(b);
+}
+
+/*
+ * draw_polygon_filled as it was before the edge table: every row scans
+ * every edge, qsorts the crossings and draws one line per span.
+ */
+static void legacy_draw_polygon_filled(SDL_Renderer *renderer, struct polygon *p)
+{
+   struct point *points = (struct point *)polygon_vertices(p);
+   int nsides = p->nsides;
+
+   float max_y = points[0].y;
+   float min_y = points[0].y;
+
+   for (int i = 0; i < nsides; i ++)
+   {
+      max_y = points[i].y > max_y ? points[i].y : max_y;
+      min_y = points[i].y < min_y ? points[i].y : min_y;
+   }
+
+   float *nodes_x = (float *)malloc(sizeof(float) * nsides);
+
+   for (int y = min_y; y <= max_y; y++)
+   {
+      int nint = 0;
+
+      for (int i = 0; i < nsides; i++)
+      {
+         int ind1 = i == 0 ? nsides - 1 : i - 1;
+         int ind2 = i;
+         float x1, y1, x2, y2;
+
+         y1 = points[ind1].y;
+         y2 = points[ind2].y;
+         if (y1 < y2) {
+            x1 = points[ind1].x;
+            x2 = points[ind2].x;
+         } else if (y1 > y2) {
+            y2 = points[ind1].y;
+            y1 = points[ind2].y;
+            x2 = points[ind1].x;
+            x1 = points[ind2].x;
+         } else {
+            continue;
+         }
+         if ( ((y >= y1) && (y < y2)) || ((y == max_y) && (y > y1) && (y <= y2)) )
+            nodes_x[nint++] = (y - y1) * (x2 - x1) / (y2 - y1) + x1;
+      }
+
+      qsort(nodes_x, nint, sizeof(float), legacy_fpolycmp);
+
+      if (nint % 2 == 0)
+         for (int k = 0; k < nint; k += 2)
+            SDL_RenderDrawLineF(renderer, nodes_x[k], y, nodes_x[k + 1], y);
+   }
+
+   free(nodes_x);
+}
+
+// filled polygons into a software renderer: old per row scan, edge table, edge table batched
+struct fill_bench
+{
+   SDL_Renderer *renderer;
+   struct polygon *p[BENCH_FILLS];
+   struct line_batch batch;
+};
+
+static void run_fill_legacy(void *data)
+{
+   struct fill_bench *b = (struct fill_bench *)data;
+
+   for (int i = 0; i < BENCH_FILLS; i++)
+      legacy_draw_polygon_filled(b->renderer, b->p[i]);
+}
+
+static void run_fill(void *data)
+{
+   struct fill_bench *b = (struct fill_bench *)data;
+
+   for (int i = 0; i < BENCH_FILLS; i++)
+      draw_polygon_filled(b->renderer, b->p[i]);
+}
+
+static void run_fill_batched(void *data)
+{
+   struct fill_bench *b = (struct fill_bench *)data;
+
+   for (int i = 0; i < BENCH_FILLS; i++)
+      line_batch_polygon_filled(&b->batch, b->p[i]);
+   line_batch_flush(b->renderer, &b->batch);
+}
+
+// filled polygons into a software renderer: old per row scan, edge table, edge table batched
+static void bench_polygon_filled(int nsides)
+{
+   SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, 1000, 1000, 32, SDL_PIXELFORMAT_ARGB8888);
+   SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+
+   if (renderer == NULL)
+   {
+      printf("draw_polygon_filled %3d sides  skipped, no software renderer\n", nsides);
+      SDL_FreeSurface(surface);
+      return;
+   }
+
+   struct fill_bench *b = (struct fill_bench *)calloc(1, sizeof(struct fill_bench));
+
+   b->renderer = renderer;
+   b->batch.color = (SDL_Color){ 255, 255, 255, 255 };
+
+   for (int i = 0; i < BENCH_FILLS; i++)
+      b->p[i] = create_rand_polygon(nsides, 100 + rand() % 800, 100 + rand() % 800, 0.3f * i, 50, 35, 1);
+
+   SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+
+   bench_run("legacy_draw_polygon_filled", nsides, BENCH_FILLS, run_fill_legacy, b);
+   bench_run("draw_polygon_filled", nsides, BENCH_FILLS, run_fill, b);
+   bench_run("line_batch_polygon_filled", nsides, BENCH_FILLS, run_fill_batched, b);
+
+   for (int i = 0; i < BENCH_FILLS; i++)
+      free_polygon(b->p[i]);
+
+   line_batch_free(&b->batch);
+   free(b);
+   SDL_DestroyRenderer(renderer);
+   SDL_FreeSurface(surface);
+}
+
+struct frame_bench
+{
+   SDL_Renderer *renderer;
+   struct polygon **p;
+   int count;
+   struct line_batch batch;
+   struct framebuffer *fb;
+};
+
+static void run_frame_sdl(void *data)
+{
+   struct frame_bench *b = (struct frame_bench *)data;
+
+   SDL_RenderClear(b->renderer);
+   for (int i = 0; i < b->count; i++)
+      draw_polygon(b->renderer, b->p[i]);
+}
+
+static void run_frame_batched(void *data)
+{
+   struct frame_bench *b = (struct frame_bench *)data;
+
+   SDL_RenderClear(b->renderer);
+   for (int i = 0; i < b->count; i++)
+      line_batch_polygon(&b->batch, b->p[i]);
+   line_batch_flush(b->renderer, &b->batch);
+}
+
+static void run_frame_framebuffer(void *data)
+{
+   struct frame_bench *b = (struct frame_bench *)data;
+
+   framebuffer_clear(b->fb, 0xff000000);
+   for (int i = 0; i < b->count; i++)
+      framebuffer_polygon(b->fb, b->p[i]);
+   framebuffer_render(b->fb);
+}
+
+/*
+ * whole frames of outlined polygons: one SDL_Renderer call per
+ * polygon, one batched geometry call, and the cpu framebuffer with one
+ * band and with one band per cpu. items are polygons.
+ */
+static void bench_framebuffer(int count)
+{
+   SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, 1000, 1000, 32, SDL_PIXELFORMAT_ARGB8888);
+   SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+
+   if (renderer == NULL)
+   {
+      printf("frame %5d polygons  skipped, no software renderer\n", count);
+      SDL_FreeSurface(surface);
+      return;
+   }
+
+   struct frame_bench b = { 0 };
+   struct framebuffer single, banded;
+
+   framebuffer_init(&single, 1000, 1000, 1);
+   framebuffer_init(&banded, 1000, 1000, 0);
+
+   b.renderer = renderer;
+   b.count = count;
+   b.p = (struct polygon **)malloc(sizeof(struct polygon *) * count);
+   b.batch.color = (SDL_Color){ 255, 255, 255, 255 };
+
+   for (int i = 0; i < count; i++)
+      b.p[i] = create_rand_polygon(24, rand() % 1000, rand() % 1000, 0.3f * i, 50, 35, 1);
+
+   SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+
+   bench_run("frame_draw_polygon", 24, count, run_frame_sdl, &b);
+   bench_run("frame_line_batch", 24, count, run_frame_batched, &b);
+
+   b.fb = &single;
+   bench_run("frame_framebuffer_1_band", 24, count, run_frame_framebuffer, &b);
+
+   // one cpu gets one band, which is the row above
+   if (banded.nbands > 1)
+   {
+      char name[48];
+      snprintf(name, sizeof(name), "frame_framebuffer_%d_bands", banded.nbands);
+
+      b.fb = &banded;
+      bench_run(name, 24, count, run_frame_framebuffer, &b);
+   }
+
+   for (int i = 0; i < count; i++)
+      free_polygon(b.p[i]);
+   free(b.p);
+
+   framebuffer_free(&single);
+   framebuffer_free(&banded);
+   line_batch_free(&b.batch);
+   SDL_DestroyRenderer(renderer);
+   SDL_FreeSurface(surface);
+}
+
+struct sincos_bench
+{
+   float angles[BENCH_ANGLES];
+   float sum;
+};
+
+// what the spawn and vector code called before
+static void run_sincos_legacy(void *data)
+{
+   struct sincos_bench *b = (struct sincos_bench *)data;
+
+   for (int i = 0; i < BENCH_ANGLES; i++)
+      b->sum += (float)sin(b->angles[i]) + (float)cos(b->angles[i]);
+}
+
+static void run_sincos_libm(void *data)
+{
+   struct sincos_bench *b = (struct sincos_bench *)data;
+
+   for (int i = 0; i < BENCH_ANGLES; i++)
+      b->sum += sinf(b->angles[i]) + cosf(b->angles[i]);
+}
+
+static void run_sincos(void *data)
+{
+   struct sincos_bench *b = (struct sincos_bench *)data;
+
+   for (int i = 0; i < BENCH_ANGLES; i++)
+   {
+      float s, c;
+      fast_sincosf(b->angles[i], &s, &c);
+      b->sum += s + c;
+   }
+}
+
+/*
+ * fast_sincosf against double sin and cos, sinf and cosf, then a sweep of every 2^-12
+ * step up to FAST_SINCOS_MAX against double sin and cos to check the
+ * error bound. returns -1 when it's broken.
+ */
+static int bench_sincos()
+{
+   struct sincos_bench b;
+
+   b.sum = 0;
+   for (int i = 0; i < BENCH_ANGLES; i++)
+      b.angles[i] = 20.0f * rand() / (float)RAND_MAX - 10.0f;
+
+   bench_run("legacy_sin_cos", 0, BENCH_ANGLES, run_sincos_legacy, &b);
+   bench_run("sinf_cosf", 0, BENCH_ANGLES, run_sincos_libm, &b);
+   bench_run("fast_sincosf", 0, BENCH_ANGLES, run_sincos, &b);
+
+   double error = 0;
+   float worst = 0;
+   long steps = (long)FAST_SINCOS_MAX * 4096;
+
+   for (long i = -steps; i <= steps; i++)
+   {
+      float x = i / 4096.0f;
+      float s, c;
+
+      fast_sincosf(x, &s, &c);
+
+      double e = fmax(fabs(s - sin(x)), fabs(c - cos(x)));
+      if (e > error)
+      {
+         error = e;
+         worst = x;
+      }
+   }
+
+   printf("   fast_sincosf max error %g at %g, bound %g\n", error, worst, FAST_SINCOS_ERROR);
+
+   if (error > FAST_SINCOS_ERROR)
+   {
+      printf("   fast_sincosf is over its error bound\n");
+      return -1;
+   }
+
+   return 0;
+}
+
+static int write_csv(const char *path)
+{
+   FILE *file = fopen(path, "w");
+
+   if (file == NULL)
+      return -1;
+
+   fprintf(file, "name,nsides,count,median_ns,p99_ns,min_ns,cflags\n");
+
+   for (int i = 0; i < nresults; i++)
+      fprintf(file, "%s,%d,%d,%.2f,%.2f,%.2f,\"%s\"\n", results[i].name, results[i].nsides,
+            results[i].count, results[i].median, results[i].p99, results[i].min, BENCH_CFLAGS);
+
+   return fclose(file) == 0 ? 0 : -1;
+}
+
+static int write_json(const char *path)
+{
+   FILE *file = fopen(path, "w");
+
+   if (file == NULL)
+      return -1;
+
+   fprintf(file, "{\n  \"cflags\": \"%s\",\n  \"warmup\": %d,\n  \"repetitions\": %d,\n  \"results\": [\n",
+         BENCH_CFLAGS, BENCH_WARMUP, BENCH_REPS);
+
+   for (int i = 0; i < nresults; i++)
+      fprintf(file, "    { \"name\": \"%s\", \"nsides\": %d, \"count\": %d, \"median_ns\": %.2f, \"p99_ns\": %.2f, \"min_ns\": %.2f }%s\n",
+            results[i].name, results[i].nsides, results[i].count,
+            results[i].median, results[i].p99, results[i].min, i + 1 < nresults ? "," : "");
+
+   fprintf(file, "  ]\n}\n");
+
+   return fclose(file) == 0 ? 0 : -1;
+}
+
+/*
+ * usage:
+ * astroids-bench [--csv file] [--json file]
+ */
+int main(int argc, char **argv)
+{
+   const char *csv = NULL;
+   const char *json = NULL;
+
+   for (int i = 1; i + 1 < argc; i++)
+   {
+      if (strcmp(argv[i], "--csv") == 0)
+         csv = argv[++i];
+      else if (strcmp(argv[i], "--json") == 0)
+         json = argv[++i];
+   }
+
+   printf("built with %s\n", BENCH_CFLAGS);
+
+   primitives_init();
+
+   srand(1);
+
+   int failed = bench_sincos() != 0;
+
+   int sizes[] = { 6, 24, 96, 384 };
+   for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+      bench_point_polygon_collision(sizes[i]);
+
+   bench_polygon_polygon_collision(3, 24);
+   bench_polygon_polygon_collision(24, 24);
+   bench_polygon_polygon_collision(96, 96);
+
+   bench_polygons_rebuild(6, 4096);
+   bench_polygons_rebuild(24, 4096);
+   bench_polygons_rebuild(24, 65536);
+
+   bench_polygons_moved(24, 4096);
+
+   bench_create_rand_polygon(6);
+   bench_create_rand_polygon(24);
+   bench_create_rand_polygon(96);
+
+   bench_polygon_filled(6);
+   bench_polygon_filled(24);
+   bench_polygon_filled(96);
+
+   bench_framebuffer(1024);
+   bench_framebuffer(4096);
+
+   if (csv != NULL && write_csv(csv) != 0)
+      printf("could not write %s\n", csv);
+
+   if (json != NULL && write_json(json) != 0)
+      printf("could not write %s\n", json);
+
+   return failed;
+}
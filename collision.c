@@ -1,110 +1,341 @@
 #include <math.h>
-#include <stdlib.h>
+#include <stddef.h>
+#include "collision.h"
 
 struct point
 {
    float x, y;
 };
 
-static int fpolycmp(const void *a, const void *b)
+/*
+ * even-odd test on a scanline through the point. an edge crosses the
+ * scanline when y is in [y1, y2) or, on the top row, in (y1, y2]. the
+ * point is inside when it sits strictly between crossing pairs, which
+ * is the same as an even number of crossings with an odd number of them
+ * left of x and none exactly on x. counting them means nothing needs to
+ * be stored or sorted.
+ */
+static int point_vertices_collision(float x, float y, const float *polygon, int nsides, float max_y)
 {
-   return *(float *)a - *(float *)b;
+   if (polygon == NULL)
+      return 0;
+
+   struct point *points = (struct point *)polygon;
+
+   int nint = 0;
+   int nleft = 0;
+
+   for (int i = 0, j = nsides - 1; i < nsides; j = i++)
+   {
+      float x1, y1, x2, y2;
+
+      if (points[j].y < points[i].y) {
+         x1 = points[j].x;
+         y1 = points[j].y;
+         x2 = points[i].x;
+         y2 = points[i].y;
+      } else if (points[j].y > points[i].y) {
+         x1 = points[i].x;
+         y1 = points[i].y;
+         x2 = points[j].x;
+         y2 = points[j].y;
+      } else {
+         continue;
+      }
+
+      if ( ((y >= y1) && (y < y2)) || ((y == max_y) && (y > y1) && (y <= y2)) )
+      {
+         float node_x = (y - y1) * (x2 - x1) / (y2 - y1) + x1;
+
+         // on a crossing is never inside
+         if (node_x == x)
+            return 0;
+
+         nint++;
+         nleft += node_x < x;
+      }
+   }
+
+   return nint % 2 == 0 && nleft % 2 == 1;
 }
 
-int point_polygon_collision(float x, float y, const float *polygon, int nsides)
+static int outside_bounds(const struct polygon *p, float x, float y)
 {
-   if (polygon == NULL)
+   return x < p->bounds.min_x || x > p->bounds.max_x || y < p->bounds.min_y || y > p->bounds.max_y;
+}
+
+int point_polygon_collision(float x, float y, struct polygon *p)
+{
+   if (p == NULL)
       return 0;
 
-   struct point *points = (struct point *)polygon;
+   // miss if outside bounds
+   if (outside_bounds(p, x, y))
+      return 0;
+
+   // bounds are only close until the vertices get built
+   if (p->dirty)
+   {
+      polygon_update(p);
+
+      if (outside_bounds(p, x, y))
+         return 0;
+   }
+
+   return point_vertices_collision(x, y, p->vertices, p->nsides, p->bounds.max_y);
+}
+
+/*
+ * sweep a point from (x0, y0) to (x1, y1) through p, so fast points
+ * can't skip over it between steps. on a hit t is how far along the
+ * segment the first contact is, from 0 to 1, and 0 if it starts inside.
+ */
+int segment_polygon_collision(float x0, float y0, float x1, float y1, struct polygon *p, float *t)
+{
+   if (p == NULL)
+      return 0;
+
+   float dx = x1 - x0;
+   float dy = y1 - y0;
+
+   // miss if the closest point of the segment is outside the bounding circle
+   float length = dx * dx + dy * dy;
+   float s = length > 0 ? ((p->x - x0) * dx + (p->y - y0) * dy) / length : 0;
+   s = s < 0 ? 0 : s > 1 ? 1 : s;
+
+   float cx = x0 + dx * s - p->x;
+   float cy = y0 + dy * s - p->y;
+   float r = polygon_bounding_radius(p);
+
+   if (cx * cx + cy * cy > r * r)
+      return 0;
 
-   float max_y = points[0].y;
-   float min_y = points[0].y;
+   polygon_update(p);
 
-   for (int i = 0; i < nsides; i ++)
+   // miss if the segment's bounds are outside the polygon's
+   if ((x0 < p->bounds.min_x && x1 < p->bounds.min_x) || (x0 > p->bounds.max_x && x1 > p->bounds.max_x) ||
+       (y0 < p->bounds.min_y && y1 < p->bounds.min_y) || (y0 > p->bounds.max_y && y1 > p->bounds.max_y))
+      return 0;
+
+   float first = INFINITY;
+
+   if (point_vertices_collision(x0, y0, p->vertices, p->nsides, p->bounds.max_y))
+      first = 0;
+
+   // earliest crossing of an edge, where x0 + d * u = a + (b - a) * v
+   struct point *points = (struct point *)p->vertices;
+
+   for (int i = 0, j = p->nsides - 1; i < p->nsides && first > 0; j = i++)
    {
-      max_y = points[i].y > max_y ? points[i].y : max_y;
-      min_y = points[i].y < min_y ? points[i].y : min_y;
+      float ex = points[i].x - points[j].x;
+      float ey = points[i].y - points[j].y;
+      float denom = dx * ey - dy * ex;
+
+      // parallel edges are crossed through their neighbours
+      if (denom == 0)
+         continue;
+
+      float wx = points[j].x - x0;
+      float wy = points[j].y - y0;
+      float u = (wx * ey - wy * ex) / denom;
+      float v = (wx * dy - wy * dx) / denom;
+
+      if (u >= 0 && u <= 1 && v >= 0 && v <= 1 && u < first)
+         first = u;
    }
 
-   int nint;
-   float *nodes_x = (float *)malloc(sizeof(float) * nsides);
+   if (first == INFINITY)
+      return 0;
+
+   if (t != NULL)
+      *t = first;
+
+   return 1;
+}
+
+// project hull onto axis
+static void hull_project(const struct polygon *p, float ax, float ay, float *min, float *max)
+{
+   struct point *points = (struct point *)p->vertices;
 
-   nint = 0;
+   *min = *max = points[p->hull[0]].x * ax + points[p->hull[0]].y * ay;
 
-   //  Build a list of nodes.
-   int ind1;
-   int ind2;
-   for (int i = 0; i < nsides; i++)
+   for (int i = 1; i < p->nhull; i++)
    {
-      float x1;
-      float y1;
-      float x2;
-      float y2;
-
-      // get current point at i == 0
-      if (i == 0) {
-         ind1 = nsides - 1;
-         ind2 = 0;
-      } else {
-         ind1 = i - 1;
-         ind2 = i;
-      }
+      float d = points[p->hull[i]].x * ax + points[p->hull[i]].y * ay;
+      *min = d < *min ? d : *min;
+      *max = d > *max ? d : *max;
+   }
+}
 
-      y1 = points[ind1].y;
-      y2 = points[ind2].y;
-      if (y1 < y2) {
-         x1 = points[ind1].x;
-         x2 = points[ind2].x;
-      } else if (y1 > y2) {
-         y2 = points[ind1].y;
-         y1 = points[ind2].y;
-         x2 = points[ind1].x;
-         x1 = points[ind2].x;
-      } else {
+/*
+ * separating axis test using the edge normals of a's hull. returns 0
+ * if one of them separates the hulls, otherwise keeps the axis with
+ * the smallest overlap in c.
+ */
+static int hull_axes_overlap(const struct polygon *a, const struct polygon *b, struct contact *c)
+{
+   struct point *points = (struct point *)a->vertices;
+
+   for (int i = 0, j = a->nhull - 1; i < a->nhull; j = i++)
+   {
+      float ax = -(points[a->hull[i]].y - points[a->hull[j]].y);
+      float ay = points[a->hull[i]].x - points[a->hull[j]].x;
+      float length = sqrtf(ax * ax + ay * ay);
+
+      if (length == 0)
          continue;
-      }
-      if ( ((y >= y1) && (y < y2)) || ((y == max_y) && (y > y1) && (y <= y2)) )
+
+      ax /= length;
+      ay /= length;
+
+      float min_a, max_a, min_b, max_b;
+      hull_project(a, ax, ay, &min_a, &max_a);
+      hull_project(b, ax, ay, &min_b, &max_b);
+
+      float overlap = (max_a < max_b ? max_a : max_b) - (min_a > min_b ? min_a : min_b);
+
+      if (overlap <= 0)
+         return 0;
+
+      if (overlap < c->depth)
       {
-         nodes_x[nint++] = (y - y1) * (x2 - x1) / (y2 - y1) + x1;
+         c->nx = ax;
+         c->ny = ay;
+         c->depth = overlap;
       }
    }
 
-   qsort(nodes_x, nint, sizeof(float), fpolycmp);
+   return 1;
+}
+
+// true if segments ab and cd cross each other
+static int segment_segment_collision(struct point a, struct point b, struct point c, struct point d)
+{
+   float d1 = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+   float d2 = (b.x - a.x) * (d.y - a.y) - (b.y - a.y) * (d.x - a.x);
+   float d3 = (d.x - c.x) * (a.y - c.y) - (d.y - c.y) * (a.x - c.x);
+   float d4 = (d.x - c.x) * (b.y - c.y) - (d.y - c.y) * (b.x - c.x);
+
+   return ((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) &&
+          ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0));
+}
+
+struct box
+{
+   float min_x, min_y, max_x, max_y;
+};
+
+// true if edge ab is entirely on one side of the box
+static int edge_outside_box(struct point a, struct point b, const struct box *box)
+{
+   return (a.x < box->min_x && b.x < box->min_x) || (a.x > box->max_x && b.x > box->max_x) ||
+          (a.y < box->min_y && b.y < box->min_y) || (a.y > box->max_y && b.y > box->max_y);
+}
+
+/*
+ * exact test for concave polygons. the outlines can only cross where
+ * the bounds overlap, so only edges reaching into that box get tested
+ * against each other. when no edges cross the outlines are either
+ * apart or one is inside the other, and then any one vertex of the
+ * inner one is inside the outer one.
+ */
+static int polygon_polygon_refine(struct polygon *p1, struct polygon *p2)
+{
+   struct point *points1 = (struct point *)p1->vertices;
+   struct point *points2 = (struct point *)p2->vertices;
+
+   struct box overlap =
+   {
+      p1->bounds.min_x > p2->bounds.min_x ? p1->bounds.min_x : p2->bounds.min_x,
+      p1->bounds.min_y > p2->bounds.min_y ? p1->bounds.min_y : p2->bounds.min_y,
+      p1->bounds.max_x < p2->bounds.max_x ? p1->bounds.max_x : p2->bounds.max_x,
+      p1->bounds.max_y < p2->bounds.max_y ? p1->bounds.max_y : p2->bounds.max_y,
+   };
 
-   // check if point is inside this
-   if (nint % 2 == 0)
+   for (int i = 0, j = p1->nsides - 1; i < p1->nsides; j = i++)
    {
-      for (int k = 0; k < nint; k += 2)
+      struct point a = points1[j];
+      struct point b = points1[i];
+
+      if (edge_outside_box(a, b, &overlap))
+         continue;
+
+      for (int k = 0, l = p2->nsides - 1; k < p2->nsides; l = k++)
       {
-         if (x > nodes_x[k] && x < nodes_x[k + 1])
+         if (!edge_outside_box(points2[l], points2[k], &overlap) &&
+             segment_segment_collision(a, b, points2[l], points2[k]))
             return 1;
       }
    }
 
-   free(nodes_x);
+   return point_polygon_collision(points1[0].x, points1[0].y, p2) ||
+          point_polygon_collision(points2[0].x, points2[0].y, p1);
+}
 
-   return 0;
+int polygon_polygon_collision(struct polygon *p1, struct polygon *p2)
+{
+   return polygon_polygon_contact(p1, p2, NULL);
 }
 
-int polygon_polygon_collision(const float *p1, int nsides1, const float *p2, int nsides2)
+/*
+ * separating axis test for convex polygons. concave ones go straight
+ * to the exact test instead, hulls of astroids overlap long before
+ * their outlines do so testing them first mostly costs time. the
+ * contact normal and depth come from the hulls either way so they are
+ * only approximate for concave polygons.
+ */
+int polygon_polygon_contact(struct polygon *p1, struct polygon *p2, struct contact *c)
 {
-   struct point *points1 = (struct point *)p1;
-   struct point *points2 = (struct point *)p2;
+   if (p1 == NULL || p2 == NULL)
+      return 0;
 
-   // see if any point of p1 is inside p2
-   for (int i = 0; i < nsides1; i++)
+   // miss if bounding circles are apart
+   float dx = p2->x - p1->x;
+   float dy = p2->y - p1->y;
+   float r = polygon_bounding_radius(p1) + polygon_bounding_radius(p2);
+
+   if (dx * dx + dy * dy > r * r)
+      return 0;
+
+   // everything past here needs the vertices
+   polygon_update(p1);
+   polygon_update(p2);
+
+   // miss if bounds are apart
+   if (p1->bounds.max_x < p2->bounds.min_x || p2->bounds.max_x < p1->bounds.min_x ||
+       p1->bounds.max_y < p2->bounds.min_y || p2->bounds.max_y < p1->bounds.min_y)
+      return 0;
+
+   struct contact hull_contact = { 0, 0, INFINITY };
+
+   if (p1->convex && p2->convex)
    {
-      if (point_polygon_collision(points1[i].x, points1[i].y, p2, nsides2))
-         return 1;
+      // miss if any edge of either polygon separates them
+      if (!hull_axes_overlap(p1, p2, &hull_contact) || !hull_axes_overlap(p2, p1, &hull_contact))
+         return 0;
+   }
+   else
+   {
+      if (!polygon_polygon_refine(p1, p2))
+         return 0;
+
+      // outlines that touch have overlapping hulls, only the normal is needed
+      if (c != NULL && (!hull_axes_overlap(p1, p2, &hull_contact) || !hull_axes_overlap(p2, p1, &hull_contact)))
+         hull_contact.depth = 0;
    }
 
-   // see if any point of p2 is inside p1
-   for (int i = 0; i < nsides2; i++)
+   if (c != NULL)
    {
-      if (point_polygon_collision(points2[i].x, points2[i].y, p1, nsides1))
-         return 1;
+      // point normal from p1 towards p2
+      if (hull_contact.nx * dx + hull_contact.ny * dy < 0)
+      {
+         hull_contact.nx = -hull_contact.nx;
+         hull_contact.ny = -hull_contact.ny;
+      }
+
+      *c = hull_contact;
    }
 
-   return 0;
+   return 1;
 }
@@ -1,7 +1,22 @@
 #ifndef COLLISION_DETECTION
 #define COLLISION_DETECTION
 
-int point_polygon_collision      (float x, float y, const float *polygon, int nsides);
-int polygon_polygon_collision    (const float *p1, int nsides1, const float *p2, int nsides2);
+#include "primitives.h"
+
+typedef struct contact contact;
+
+struct contact
+{
+   // unit direction to push p2 out of p1
+   float nx, ny;
+
+   // distance to push along the normal
+   float depth;
+};
+
+int point_polygon_collision      (float x, float y, struct polygon *p);
+int segment_polygon_collision    (float x0, float y0, float x1, float y1, struct polygon *p, float *t);
+int polygon_polygon_collision    (struct polygon *p1, struct polygon *p2);
+int polygon_polygon_contact      (struct polygon *p1, struct polygon *p2, struct contact *c);
 
 #endif
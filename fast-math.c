@@ -0,0 +1,56 @@
+#include <math.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "fast-math.h"
+
+// pi / 2 split in three so k * part is exact for the k we see
+#define PIO2_1      1.5703125f
+#define PIO2_2      4.837512969970703125e-4f
+#define PIO2_3      7.54978995489188216e-8f
+
+#define TWO_OVER_PI 0.63661977236758134308f
+#define ROUND_SHIFT 12582912.0f
+
+/*
+ * sine and cosine from one range reduction. x is moved into
+ * [-pi / 4, pi / 4] around the nearest multiple of pi / 2, both short
+ * polynomials run on what's left and the quadrant picks signs and
+ * which one is which.
+ */
+void fast_sincosf(float x, float *s, float *c)
+{
+   // also catches nan and inf
+   if (!(fabsf(x) <= FAST_SINCOS_MAX))
+   {
+      *s = sinf(x);
+      *c = cosf(x);
+      return;
+   }
+
+   // adding 1.5 * 2^23 rounds to the nearest integer without a call to floorf
+   float shifted = x * TWO_OVER_PI + ROUND_SHIFT;
+   float k = shifted - ROUND_SHIFT;
+   int quadrant = (int)k;
+
+   float r = ((x - k * PIO2_1) - k * PIO2_2) - k * PIO2_3;
+   float r2 = r * r;
+
+   float sr = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+   float cr = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+   /*
+    * odd quadrants swap sine and cosine, quadrants 2 and 3 flip the
+    * sine and 1 and 2 the cosine. done on the bits since the quadrant
+    * is random enough that branches on it mispredict.
+    */
+   Uint32 sb, cb;
+   memcpy(&sb, &sr, sizeof(sb));
+   memcpy(&cb, &cr, sizeof(cb));
+
+   Uint32 swap = -(Uint32)(quadrant & 1);
+   Uint32 sin_bits = ((sb & ~swap) | (cb & swap)) ^ ((Uint32)(quadrant & 2) << 30);
+   Uint32 cos_bits = ((cb & ~swap) | (sb & swap)) ^ ((Uint32)((quadrant + 1) & 2) << 30);
+
+   memcpy(s, &sin_bits, sizeof(sin_bits));
+   memcpy(c, &cos_bits, sizeof(cos_bits));
+}
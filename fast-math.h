@@ -0,0 +1,17 @@
+/*
+ * Description:
+ * Float sine and cosine for the transform and spawn code
+ */
+
+#ifndef FAST_MATH
+#define FAST_MATH
+
+// past this the range reduction loses bits and libm is used instead
+#define FAST_SINCOS_MAX     8192.0f
+
+// max absolute error of fast_sincosf up to FAST_SINCOS_MAX, checked by astroids-bench
+#define FAST_SINCOS_ERROR   2e-7f
+
+void fast_sincosf            (float x, float *s, float *c);
+
+#endif
@@ -0,0 +1,438 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "framebuffer.h"
+
+static void framebuffer_band_render(struct framebuffer *fb, int y0, int y1);
+
+static int framebuffer_worker(void *data)
+{
+   struct framebuffer_band *band = (struct framebuffer_band *)data;
+   struct framebuffer *fb = band->fb;
+
+   for (;;)
+   {
+      SDL_SemWait(band->start);
+
+      if (fb->quit)
+         break;
+
+      framebuffer_band_render(fb, band->y0, band->y1);
+      SDL_SemPost(fb->done);
+   }
+
+   return 0;
+}
+
+/*
+ * nthreads 0 uses one band per cpu. falls back to a single band when
+ * threads can't be made.
+ */
+int framebuffer_init(struct framebuffer *fb, int width, int height, int nthreads)
+{
+   if (fb == NULL || width <= 0 || height <= 0)
+      return -1;
+
+   if (nthreads <= 0)
+      nthreads = SDL_GetCPUCount();
+   if (nthreads > height)
+      nthreads = height;
+   if (nthreads < 1)
+      nthreads = 1;
+
+   fb->width = width;
+   fb->height = height;
+   fb->color = 0xffffffff;
+   fb->clear_color = 0xff000000;
+   fb->clear = 1;
+
+   fb->lines = NULL;
+   fb->nlines = 0;
+   fb->max_lines = 0;
+
+   fb->nbands = 0;
+   fb->done = NULL;
+   fb->quit = 0;
+
+   fb->pixels = (Uint32 *)malloc(sizeof(Uint32) * width * height);
+   fb->bands = (struct framebuffer_band *)malloc(sizeof(struct framebuffer_band) * nthreads);
+
+   if (fb->pixels == NULL || fb->bands == NULL)
+   {
+      framebuffer_free(fb);
+      return -1;
+   }
+
+   fb->done = nthreads > 1 ? SDL_CreateSemaphore(0) : NULL;
+   if (fb->done == NULL)
+      nthreads = 1;
+
+   // band 0 belongs to the caller
+   fb->bands[0].fb = fb;
+   fb->bands[0].thread = NULL;
+   fb->bands[0].start = NULL;
+   fb->nbands = 1;
+
+   for (int i = 1; i < nthreads; i++)
+   {
+      struct framebuffer_band *band = &fb->bands[i];
+
+      band->fb = fb;
+      band->start = SDL_CreateSemaphore(0);
+      band->thread = band->start ? SDL_CreateThread(framebuffer_worker, "framebuffer", band) : NULL;
+
+      if (band->thread == NULL)
+      {
+         if (band->start != NULL)
+            SDL_DestroySemaphore(band->start);
+         break;
+      }
+
+      fb->nbands++;
+   }
+
+   // split rows evenly over the bands that exist
+   for (int i = 0; i < fb->nbands; i++)
+   {
+      fb->bands[i].y0 = height * i / fb->nbands;
+      fb->bands[i].y1 = height * (i + 1) / fb->nbands;
+   }
+
+   return 0;
+}
+
+void framebuffer_set_color(struct framebuffer *fb, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+   fb->color = (Uint32)a << 24 | (Uint32)r << 16 | (Uint32)g << 8 | b;
+}
+
+// drops queued lines, the bands clear on the next render
+void framebuffer_clear(struct framebuffer *fb, Uint32 color)
+{
+   fb->clear_color = color;
+   fb->clear = 1;
+   fb->nlines = 0;
+}
+
+static int framebuffer_push(struct framebuffer *fb, float x1, float y1, float x2, float y2, Uint32 color)
+{
+   if (fb->nlines == fb->max_lines)
+   {
+      int max_lines = fb->max_lines ? fb->max_lines * 2 : 1024;
+
+      struct framebuffer_line *lines = (struct framebuffer_line *)realloc(fb->lines, sizeof(struct framebuffer_line) * max_lines);
+      if (lines == NULL)
+         return -1;
+
+      fb->lines = lines;
+      fb->max_lines = max_lines;
+   }
+
+   struct framebuffer_line *l = &fb->lines[fb->nlines++];
+   l->x1 = x1;
+   l->y1 = y1;
+   l->x2 = x2;
+   l->y2 = y2;
+   l->color = color;
+
+   return 0;
+}
+
+int framebuffer_line(struct framebuffer *fb, float x1, float y1, float x2, float y2)
+{
+   if (fb == NULL)
+      return -1;
+
+   return framebuffer_push(fb, x1, y1, x2, y2, fb->color);
+}
+
+int framebuffer_polygon(struct framebuffer *fb, struct polygon *p)
+{
+   if (fb == NULL || p == NULL)
+      return -1;
+
+   SDL_FPoint *vertices = (SDL_FPoint *)polygon_vertices(p);
+
+   for (int i = 0, j = p->nsides - 1; i < p->nsides; j = i++)
+      if (framebuffer_push(fb, vertices[j].x, vertices[j].y, vertices[i].x, vertices[i].y, fb->color) != 0)
+         return -1;
+
+   return 0;
+}
+
+static void framebuffer_span(void *data, int y, float x1, float x2)
+{
+   struct framebuffer *fb = (struct framebuffer *)data;
+
+   framebuffer_push(fb, x1, y + 0.5f, x2, y + 0.5f, fb->color);
+}
+
+int framebuffer_polygon_filled(struct framebuffer *fb, struct polygon *p)
+{
+   if (fb == NULL || p == NULL)
+      return -1;
+
+   return polygon_spans(p, framebuffer_span, fb);
+}
+
+/*
+ * takes over the lines of a line batch and empties it. every quad in
+ * the batch stands for the line through the middle of its ends.
+ */
+int framebuffer_batch(struct framebuffer *fb, struct line_batch *b)
+{
+   if (fb == NULL || b == NULL)
+      return -1;
+
+   b->draw_calls = 0;
+   b->drawn_vertices = b->nvertices;
+
+   for (int i = 0; i < b->nvertices; i += 4)
+   {
+      SDL_Vertex *v = b->vertices + i;
+      SDL_Color c = v[0].color;
+
+      framebuffer_push(fb,
+            (v[0].position.x + v[1].position.x) / 2, (v[0].position.y + v[1].position.y) / 2,
+            (v[2].position.x + v[3].position.x) / 2, (v[2].position.y + v[3].position.y) / 2,
+            (Uint32)c.a << 24 | (Uint32)c.r << 16 | (Uint32)c.g << 8 | c.b);
+   }
+
+   b->nvertices = 0;
+   b->nindices = 0;
+
+   return 0;
+}
+
+/*
+ * liang barsky clip to the buffer so lines far off screen don't cost
+ * anything. returns 0 when nothing is left.
+ */
+static int clip_line(float *x1, float *y1, float *x2, float *y2, float max_x, float max_y)
+{
+   float dx = *x2 - *x1;
+   float dy = *y2 - *y1;
+   float p[4] = { -dx, dx, -dy, dy };
+   float q[4] = { *x1, max_x - *x1, *y1, max_y - *y1 };
+   float t0 = 0;
+   float t1 = 1;
+
+   for (int i = 0; i < 4; i++)
+   {
+      if (p[i] == 0)
+      {
+         if (q[i] < 0)
+            return 0;
+         continue;
+      }
+
+      float t = q[i] / p[i];
+
+      if (p[i] < 0 && t > t0)
+         t0 = t;
+      else if (p[i] > 0 && t < t1)
+         t1 = t;
+   }
+
+   if (t0 > t1)
+      return 0;
+
+   *x2 = *x1 + t1 * dx;
+   *y2 = *y1 + t1 * dy;
+   *x1 = *x1 + t0 * dx;
+   *y1 = *y1 + t0 * dy;
+
+   return 1;
+}
+
+// pixel holding a clipped coordinate, rounding can leave it just outside
+static int pixel(float v, int size)
+{
+   int i = (int)floorf(v);
+
+   return i < 0 ? 0 : i >= size ? size - 1 : i;
+}
+
+// bresenham between the pixels holding each end, only rows y0 to y1 get written
+static void band_line(struct framebuffer *fb, int y0, int y1, const struct framebuffer_line *l)
+{
+   float fx1 = l->x1, fy1 = l->y1, fx2 = l->x2, fy2 = l->y2;
+
+   // quick reject on rows before clipping
+   if ((fy1 < y0 && fy2 < y0) || (fy1 >= y1 && fy2 >= y1))
+      return;
+
+   // most lines are on screen and don't need clipping
+   int inside = fx1 >= 0 && fx2 >= 0 && fy1 >= 0 && fy2 >= 0 &&
+      fx1 < fb->width && fx2 < fb->width && fy1 < fb->height && fy2 < fb->height;
+
+   if (!inside && !clip_line(&fx1, &fy1, &fx2, &fy2, fb->width, fb->height))
+      return;
+
+   int x = pixel(fx1, fb->width), y = pixel(fy1, fb->height);
+   int ex = pixel(fx2, fb->width), ey = pixel(fy2, fb->height);
+
+   // always walk down so the band end can stop the walk
+   if (y > ey)
+   {
+      int t;
+      t = x; x = ex; ex = t;
+      t = y; y = ey; ey = t;
+   }
+
+   if (ey < y0 || y >= y1)
+      return;
+
+   // spans and flat lines fill a row directly
+   if (y == ey)
+   {
+      Uint32 *row = fb->pixels + y * fb->width;
+      int from = x < ex ? x : ex;
+      int to = x < ex ? ex : x;
+
+      for (int i = from; i <= to; i++)
+         row[i] = l->color;
+      return;
+   }
+
+   int dx = abs(ex - x);
+   int dy = ey - y;
+   int sx = x < ex ? 1 : -1;
+   int err = dx - dy;
+
+   while (y < y1)
+   {
+      if (y >= y0)
+         fb->pixels[y * fb->width + x] = l->color;
+
+      if (x == ex && y == ey)
+         break;
+
+      int e2 = err * 2;
+      if (e2 > -dy)
+      {
+         err -= dy;
+         x += sx;
+      }
+      if (e2 < dx)
+      {
+         err += dx;
+         y++;
+      }
+   }
+}
+
+static void framebuffer_band_render(struct framebuffer *fb, int y0, int y1)
+{
+   if (fb->clear)
+      for (int i = y0 * fb->width; i < y1 * fb->width; i++)
+         fb->pixels[i] = fb->clear_color;
+
+   for (int i = 0; i < fb->nlines; i++)
+      band_line(fb, y0, y1, &fb->lines[i]);
+}
+
+// rasterize every queued line, bands run in parallel
+int framebuffer_render(struct framebuffer *fb)
+{
+   if (fb == NULL)
+      return -1;
+
+   for (int i = 1; i < fb->nbands; i++)
+      SDL_SemPost(fb->bands[i].start);
+
+   framebuffer_band_render(fb, fb->bands[0].y0, fb->bands[0].y1);
+
+   for (int i = 1; i < fb->nbands; i++)
+      SDL_SemWait(fb->done);
+
+   fb->clear = 0;
+   fb->nlines = 0;
+
+   return 0;
+}
+
+// one texture upload, the texture must be ARGB8888 and the size of the buffer
+int framebuffer_present(struct framebuffer *fb, SDL_Renderer *renderer, SDL_Texture *texture)
+{
+   if (fb == NULL || renderer == NULL || texture == NULL)
+      return -1;
+
+   if (SDL_UpdateTexture(texture, NULL, fb->pixels, fb->width * sizeof(Uint32)) != 0)
+      return -1;
+
+   SDL_RenderCopy(renderer, texture, NULL, NULL);
+
+   return 0;
+}
+
+// binary ppm, alpha is dropped
+int framebuffer_write_ppm(struct framebuffer *fb, const char *path)
+{
+   if (fb == NULL || path == NULL)
+      return -1;
+
+   FILE *file = fopen(path, "wb");
+
+   if (file == NULL)
+      return -1;
+
+   fprintf(file, "P6\n%d %d\n255\n", fb->width, fb->height);
+
+   unsigned char *row = (unsigned char *)malloc(fb->width * 3);
+
+   if (row == NULL)
+   {
+      fclose(file);
+      return -1;
+   }
+
+   for (int y = 0; y < fb->height; y++)
+   {
+      Uint32 *pixels = fb->pixels + y * fb->width;
+
+      for (int x = 0; x < fb->width; x++)
+      {
+         row[x * 3] = pixels[x] >> 16;
+         row[x * 3 + 1] = pixels[x] >> 8;
+         row[x * 3 + 2] = pixels[x];
+      }
+
+      fwrite(row, 3, fb->width, file);
+   }
+
+   free(row);
+
+   return fclose(file) == 0 ? 0 : -1;
+}
+
+void framebuffer_free(struct framebuffer *fb)
+{
+   if (fb == NULL)
+      return;
+
+   // wake the workers up so they can see quit
+   fb->quit = 1;
+
+   for (int i = 1; i < fb->nbands; i++)
+   {
+      SDL_SemPost(fb->bands[i].start);
+      SDL_WaitThread(fb->bands[i].thread, NULL);
+      SDL_DestroySemaphore(fb->bands[i].start);
+   }
+
+   if (fb->done != NULL)
+      SDL_DestroySemaphore(fb->done);
+
+   free(fb->pixels);
+   free(fb->bands);
+   free(fb->lines);
+
+   fb->pixels = NULL;
+   fb->bands = NULL;
+   fb->lines = NULL;
+   fb->done = NULL;
+   fb->nbands = 0;
+   fb->nlines = 0;
+   fb->max_lines = 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Description:
+ * Software rasterizer that draws polygons into a cpu pixel buffer
+ */
+
+#ifndef FRAMEBUFFER
+#define FRAMEBUFFER
+
+#include "primitives.h"
+
+typedef struct framebuffer framebuffer;
+
+// a line waiting to be drawn, spans are horizontal lines
+struct framebuffer_line
+{
+   float x1, y1, x2, y2;
+   Uint32 color;
+};
+
+// rows a worker thread rasterizes
+struct framebuffer_band
+{
+   struct framebuffer *fb;
+   int y0, y1;
+   SDL_Thread *thread;
+   SDL_sem *start;
+};
+
+/*
+ * draws queue up lines and framebuffer_render rasterizes all of them.
+ * the rows are split into one band per thread and every band walks
+ * the whole queue, so no two threads ever write the same pixel and
+ * the result doesn't depend on the number of bands.
+ */
+struct framebuffer
+{
+   int width, height;
+
+   // ARGB8888, width * height
+   Uint32 *pixels;
+
+   // color for new lines
+   Uint32 color;
+   Uint32 clear_color;
+   char clear;
+
+   struct framebuffer_line *lines;
+   int nlines;
+   int max_lines;
+
+   // band 0 runs on the calling thread
+   struct framebuffer_band *bands;
+   int nbands;
+   SDL_sem *done;
+   char quit;
+};
+
+int framebuffer_init                (struct framebuffer *fb, int width, int height, int nthreads);
+void framebuffer_set_color          (struct framebuffer *fb, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void framebuffer_clear              (struct framebuffer *fb, Uint32 color);
+int framebuffer_line                (struct framebuffer *fb, float x1, float y1, float x2, float y2);
+int framebuffer_polygon             (struct framebuffer *fb, struct polygon *p);
+int framebuffer_polygon_filled      (struct framebuffer *fb, struct polygon *p);
+int framebuffer_batch               (struct framebuffer *fb, struct line_batch *b);
+int framebuffer_render              (struct framebuffer *fb);
+int framebuffer_present             (struct framebuffer *fb, SDL_Renderer *renderer, SDL_Texture *texture);
+int framebuffer_write_ppm           (struct framebuffer *fb, const char *path);
+void framebuffer_free               (struct framebuffer *fb);
+
+#endif
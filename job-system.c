@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include "job-system.h"
+
+// take one chunk from a queue, -1 when it's empty
+static int take_chunk(struct job_queue *q)
+{
+   if (SDL_AtomicGet(&q->next) >= q->end)
+      return -1;
+
+   int c = SDL_AtomicAdd(&q->next, 1);
+
+   return c < q->end ? c : -1;
+}
+
+// run own chunks first, then steal from the next workers along
+static void job_run(struct job_system *js, int worker)
+{
+   for (int k = 0; k < js->nworkers; k++)
+   {
+      struct job_queue *q = &js->queues[(worker + k) % js->nworkers];
+      int c;
+
+      while ((c = take_chunk(q)) >= 0)
+      {
+         int begin = c * js->chunk;
+         int end = begin + js->chunk < js->count ? begin + js->chunk : js->count;
+
+         js->func(js->data, worker, begin, end);
+      }
+   }
+}
+
+struct job_worker
+{
+   struct job_system *js;
+   int worker;
+};
+
+static int job_thread(void *data)
+{
+   struct job_worker w = *(struct job_worker *)data;
+   struct job_system *js = w.js;
+
+   free(data);
+
+   for (;;)
+   {
+      SDL_SemWait(js->start[w.worker]);
+
+      if (SDL_AtomicGet(&js->quit))
+         break;
+
+      job_run(js, w.worker);
+      SDL_SemPost(js->done);
+   }
+
+   return 0;
+}
+
+/*
+ * nthreads 0 uses one worker per cpu. falls back to fewer workers
+ * when threads can't be made, down to only the caller.
+ */
+int job_system_init(struct job_system *js, int nthreads)
+{
+   if (js == NULL)
+      return -1;
+
+   if (nthreads <= 0)
+      nthreads = SDL_GetCPUCount();
+   if (nthreads < 1)
+      nthreads = 1;
+
+   js->nworkers = 1;
+   js->done = NULL;
+   SDL_AtomicSet(&js->quit, 0);
+
+   js->threads = (SDL_Thread **)calloc(nthreads, sizeof(SDL_Thread *));
+   js->start = (SDL_sem **)calloc(nthreads, sizeof(SDL_sem *));
+   js->queues = (struct job_queue *)calloc(nthreads, sizeof(struct job_queue));
+
+   if (js->threads == NULL || js->start == NULL || js->queues == NULL)
+   {
+      job_system_free(js);
+      return -1;
+   }
+
+   if (nthreads > 1)
+      js->done = SDL_CreateSemaphore(0);
+
+   for (int i = 1; i < nthreads && js->done != NULL; i++)
+   {
+      struct job_worker *w = (struct job_worker *)malloc(sizeof(struct job_worker));
+
+      if (w == NULL)
+         break;
+
+      w->js = js;
+      w->worker = i;
+
+      js->start[i] = SDL_CreateSemaphore(0);
+      js->threads[i] = js->start[i] ? SDL_CreateThread(job_thread, "job", w) : NULL;
+
+      if (js->threads[i] == NULL)
+      {
+         if (js->start[i] != NULL)
+            SDL_DestroySemaphore(js->start[i]);
+         js->start[i] = NULL;
+         free(w);
+         break;
+      }
+
+      js->nworkers++;
+   }
+
+   return 0;
+}
+
+/*
+ * run func over count items in chunks of chunk items and wait for all
+ * of them. with one worker it's a plain loop on the calling thread.
+ */
+void job_parallel_for(struct job_system *js, int count, int chunk, job_func func, void *data)
+{
+   if (count <= 0)
+      return;
+
+   if (chunk < 1)
+      chunk = 1;
+
+   int nchunks = (count + chunk - 1) / chunk;
+
+   if (js == NULL || js->nworkers <= 1 || nchunks == 1)
+   {
+      func(data, 0, 0, count);
+      return;
+   }
+
+   js->func = func;
+   js->data = data;
+   js->count = count;
+   js->chunk = chunk;
+
+   // even split of the chunks, later workers get the leftovers
+   for (int i = 0; i < js->nworkers; i++)
+   {
+      SDL_AtomicSet(&js->queues[i].next, nchunks * i / js->nworkers);
+      js->queues[i].end = nchunks * (i + 1) / js->nworkers;
+   }
+
+   for (int i = 1; i < js->nworkers; i++)
+      SDL_SemPost(js->start[i]);
+
+   job_run(js, 0);
+
+   for (int i = 1; i < js->nworkers; i++)
+      SDL_SemWait(js->done);
+}
+
+void job_system_free(struct job_system *js)
+{
+   if (js == NULL)
+      return;
+
+   SDL_AtomicSet(&js->quit, 1);
+
+   for (int i = 1; i < js->nworkers; i++)
+   {
+      SDL_SemPost(js->start[i]);
+      SDL_WaitThread(js->threads[i], NULL);
+      SDL_DestroySemaphore(js->start[i]);
+   }
+
+   if (js->done != NULL)
+      SDL_DestroySemaphore(js->done);
+
+   free(js->threads);
+   free(js->start);
+   free(js->queues);
+
+   js->threads = NULL;
+   js->start = NULL;
+   js->queues = NULL;
+   js->done = NULL;
+   js->nworkers = 0;
+}
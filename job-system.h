@@ -0,0 +1,48 @@
+/*
+ * Description:
+ * Worker threads that split loops over entity arrays into chunks
+ */
+
+#ifndef JOB_SYSTEM
+#define JOB_SYSTEM
+
+#include <SDL2/SDL.h>
+
+typedef struct job_system job_system;
+
+// runs items begin to end - 1, worker is 0 to nworkers - 1
+typedef void (*job_func)(void *data, int worker, int begin, int end);
+
+// chunks a worker owns, the owner and thieves both take from next
+struct job_queue
+{
+   SDL_atomic_t next;
+   int end;
+};
+
+/*
+ * every parallel for splits its chunks evenly over the workers. a
+ * worker that runs out steals chunks from the others, so uneven
+ * chunks still finish together. worker 0 is the calling thread.
+ */
+struct job_system
+{
+   int nworkers;
+   SDL_Thread **threads;
+   SDL_sem **start;
+   SDL_sem *done;
+   SDL_atomic_t quit;
+
+   // current job
+   struct job_queue *queues;
+   job_func func;
+   void *data;
+   int count;
+   int chunk;
+};
+
+int job_system_init              (struct job_system *js, int nthreads);
+void job_parallel_for            (struct job_system *js, int count, int chunk, job_func func, void *data);
+void job_system_free             (struct job_system *js);
+
+#endif
@@ -0,0 +1,401 @@
+#include <stdlib.h>
+#include <string.h>
+#include "object-pool.h"
+
+int object_pool_init(struct object_pool *pool, int nsides, int capacity)
+{
+   if (pool == NULL || nsides < 3 || capacity <= 0)
+      return -1;
+
+   pool->count = 0;
+   pool->capacity = capacity;
+   pool->nsides = nsides;
+
+   pool->x = (float *)malloc(sizeof(float) * capacity);
+   pool->y = (float *)malloc(sizeof(float) * capacity);
+   pool->vx = (float *)malloc(sizeof(float) * capacity);
+   pool->vy = (float *)malloc(sizeof(float) * capacity);
+   pool->angle = (float *)malloc(sizeof(float) * capacity);
+   pool->scale = (float *)malloc(sizeof(float) * capacity);
+   pool->last_x = (float *)malloc(sizeof(float) * capacity);
+   pool->last_y = (float *)malloc(sizeof(float) * capacity);
+   pool->last_angle = (float *)malloc(sizeof(float) * capacity);
+   pool->outline = (int *)malloc(sizeof(int) * capacity);
+   pool->shape = (struct polygon *)malloc(sizeof(struct polygon) * capacity);
+   pool->vertices = (float *)malloc(sizeof(float) * capacity * nsides * 2);
+   pool->offsets = (float *)malloc(sizeof(float) * capacity * nsides * 2);
+
+   pool->outlines = NULL;
+   pool->noutlines = 0;
+   pool->max_outlines = 0;
+   pool->outline_vectors = NULL;
+   pool->outline_vertices = NULL;
+   pool->outline_hull = NULL;
+
+   if (!pool->x || !pool->y || !pool->vx || !pool->vy || !pool->angle || !pool->scale ||
+       !pool->last_x || !pool->last_y || !pool->last_angle || !pool->outline || !pool->shape || !pool->vertices ||
+       !pool->offsets)
+   {
+      object_pool_free(pool);
+      return -1;
+   }
+
+   return 0;
+}
+
+// resize one column, leaves it alone if realloc fails
+static int grow_column(void **column, size_t size)
+{
+   void *p = realloc(*column, size);
+
+   if (p == NULL)
+      return -1;
+
+   *column = p;
+   return 0;
+}
+
+// double capacity and point polygons at the moved blocks
+static int object_pool_grow(struct object_pool *pool)
+{
+   int capacity = pool->capacity * 2;
+   int stride = pool->nsides * 2;
+
+   if (grow_column((void **)&pool->x, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->y, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->vx, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->vy, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->angle, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->scale, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->last_x, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->last_y, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->last_angle, sizeof(float) * capacity) ||
+       grow_column((void **)&pool->outline, sizeof(int) * capacity) ||
+       grow_column((void **)&pool->shape, sizeof(struct polygon) * capacity) ||
+       grow_column((void **)&pool->vertices, sizeof(float) * capacity * stride) ||
+       grow_column((void **)&pool->offsets, sizeof(float) * capacity * stride))
+   {
+      // whatever got resized is still big enough for the old capacity
+      return -1;
+   }
+
+   pool->capacity = capacity;
+
+   for (int i = 0; i < pool->count; i++)
+   {
+      pool->shape[i].vertices = pool->vertices + i * stride;
+      pool->shape[i].offsets = pool->offsets + i * stride;
+   }
+
+   return 0;
+}
+
+// point polygons at the outline blocks, after they moved
+static void point_at_outlines(struct object_pool *pool)
+{
+   int stride = pool->nsides * 2;
+
+   for (int i = 0; i < pool->noutlines; i++)
+   {
+      pool->outlines[i].vectors = pool->outline_vectors + i * stride;
+      pool->outlines[i].vertices = pool->outline_vertices + i * stride;
+      pool->outlines[i].hull = pool->outline_hull + i * pool->nsides;
+   }
+
+   for (int i = 0; i < pool->count; i++)
+   {
+      pool->shape[i].vectors = pool->outlines[pool->outline[i]].vectors;
+      pool->shape[i].hull = pool->outlines[pool->outline[i]].hull;
+   }
+}
+
+// make room for at least n outlines
+static int reserve_outlines(struct object_pool *pool, int n)
+{
+   if (n <= pool->max_outlines)
+      return 0;
+
+   int max_outlines = pool->max_outlines ? pool->max_outlines : 16;
+   int stride = pool->nsides * 2;
+
+   while (max_outlines < n)
+      max_outlines *= 2;
+
+   if (grow_column((void **)&pool->outlines, sizeof(struct polygon) * max_outlines) ||
+       grow_column((void **)&pool->outline_vectors, sizeof(float) * max_outlines * stride) ||
+       grow_column((void **)&pool->outline_vertices, sizeof(float) * max_outlines * stride) ||
+       grow_column((void **)&pool->outline_hull, sizeof(int) * max_outlines * pool->nsides))
+   {
+      point_at_outlines(pool);
+      return -1;
+   }
+
+   pool->max_outlines = max_outlines;
+   point_at_outlines(pool);
+
+   return 0;
+}
+
+/*
+ * add an outline objects can use, its radius and hull get worked out
+ * here once. returns its index or -1 when out of memory.
+ */
+int object_pool_add_outline(struct object_pool *pool, const float *vectors)
+{
+   if (pool == NULL || vectors == NULL)
+      return -1;
+
+   if (reserve_outlines(pool, pool->noutlines + 1) != 0)
+      return -1;
+
+   int i = pool->noutlines;
+   int stride = pool->nsides * 2;
+
+   memcpy(pool->outline_vectors + i * stride, vectors, sizeof(float) * stride);
+
+   if (init_polygon(&pool->outlines[i], pool->outline_vectors + i * stride, pool->outline_vertices + i * stride,
+            NULL, pool->outline_hull + i * pool->nsides, pool->nsides, 0, 0, 0) != 0)
+      return -1;
+
+   return pool->noutlines++;
+}
+
+/*
+ * returns index of new object or -1 when out of memory. nothing gets
+ * built, the vertices are made the first time they are read.
+ */
+int object_pool_add(struct object_pool *pool, int outline, float x, float y, float angle, float scale, float vx, float vy)
+{
+   if (pool == NULL || outline < 0 || outline >= pool->noutlines)
+      return -1;
+
+   if (pool->count >= pool->capacity && object_pool_grow(pool) != 0)
+      return -1;
+
+   int i = pool->count++;
+   int stride = pool->nsides * 2;
+
+   pool->x[i] = x;
+   pool->y[i] = y;
+   pool->vx[i] = vx;
+   pool->vy[i] = vy;
+   pool->angle[i] = angle;
+   pool->scale[i] = scale;
+   pool->last_x[i] = x;
+   pool->last_y[i] = y;
+   pool->last_angle[i] = angle;
+   pool->outline[i] = outline;
+
+   struct polygon *p = &pool->shape[i];
+
+   *p = pool->outlines[outline];
+   p->vertices = pool->vertices + i * stride;
+   p->offsets = pool->offsets + i * stride;
+   polygon_set_transform(p, x, y, angle, scale, scale);
+
+   return i;
+}
+
+/*
+ * remove by moving the last object into index. returns 1 if an object
+ * was moved, 0 if index was the last one and -1 on error.
+ */
+int object_pool_remove(struct object_pool *pool, int index)
+{
+   if (pool == NULL || index < 0 || index >= pool->count)
+      return -1;
+
+   int last = --pool->count;
+
+   if (index == last)
+      return 0;
+
+   int stride = pool->nsides * 2;
+
+   pool->x[index] = pool->x[last];
+   pool->y[index] = pool->y[last];
+   pool->vx[index] = pool->vx[last];
+   pool->vy[index] = pool->vy[last];
+   pool->angle[index] = pool->angle[last];
+   pool->scale[index] = pool->scale[last];
+   pool->last_x[index] = pool->last_x[last];
+   pool->last_y[index] = pool->last_y[last];
+   pool->last_angle[index] = pool->last_angle[last];
+   pool->outline[index] = pool->outline[last];
+
+   memcpy(pool->vertices + index * stride, pool->vertices + last * stride, sizeof(float) * stride);
+   memcpy(pool->offsets + index * stride, pool->offsets + last * stride, sizeof(float) * stride);
+
+   // copy polygon but keep pointing at this slot's vertices
+   struct polygon *p = &pool->shape[index];
+   float *p_vertices = p->vertices;
+   float *p_offsets = p->offsets;
+
+   *p = pool->shape[last];
+   p->vertices = p_vertices;
+   p->offsets = p_offsets;
+
+   return 1;
+}
+
+/*
+ * make dst a copy of src, growing dst when it is too small. both need
+ * the same nsides. polygons keep their transforms and dirty flags so
+ * vertices only get built if the copy is drawn. outlines only get
+ * copied when src has ones dst doesn't.
+ */
+int object_pool_copy(struct object_pool *dst, const struct object_pool *src)
+{
+   if (dst == NULL || src == NULL || dst->nsides != src->nsides)
+      return -1;
+
+   while (dst->capacity < src->count)
+      if (object_pool_grow(dst) != 0)
+         return -1;
+
+   if (dst->noutlines != src->noutlines)
+   {
+      if (reserve_outlines(dst, src->noutlines) != 0)
+         return -1;
+
+      int stride = src->nsides * 2;
+
+      memcpy(dst->outlines, src->outlines, sizeof(struct polygon) * src->noutlines);
+      memcpy(dst->outline_vectors, src->outline_vectors, sizeof(float) * src->noutlines * stride);
+      memcpy(dst->outline_vertices, src->outline_vertices, sizeof(float) * src->noutlines * stride);
+      memcpy(dst->outline_hull, src->outline_hull, sizeof(int) * src->noutlines * src->nsides);
+
+      dst->noutlines = src->noutlines;
+      dst->count = 0;
+      point_at_outlines(dst);
+   }
+
+   int n = src->count;
+   int stride = src->nsides * 2;
+
+   memcpy(dst->x, src->x, sizeof(float) * n);
+   memcpy(dst->y, src->y, sizeof(float) * n);
+   memcpy(dst->vx, src->vx, sizeof(float) * n);
+   memcpy(dst->vy, src->vy, sizeof(float) * n);
+   memcpy(dst->angle, src->angle, sizeof(float) * n);
+   memcpy(dst->scale, src->scale, sizeof(float) * n);
+   memcpy(dst->last_x, src->last_x, sizeof(float) * n);
+   memcpy(dst->last_y, src->last_y, sizeof(float) * n);
+   memcpy(dst->last_angle, src->last_angle, sizeof(float) * n);
+   memcpy(dst->outline, src->outline, sizeof(int) * n);
+   memcpy(dst->vertices, src->vertices, sizeof(float) * n * stride);
+   memcpy(dst->offsets, src->offsets, sizeof(float) * n * stride);
+
+   for (int i = 0; i < n; i++)
+   {
+      struct polygon *outline = &dst->outlines[src->outline[i]];
+
+      dst->shape[i] = src->shape[i];
+      dst->shape[i].vectors = outline->vectors;
+      dst->shape[i].vertices = dst->vertices + i * stride;
+      dst->shape[i].offsets = dst->offsets + i * stride;
+      dst->shape[i].hull = outline->hull;
+   }
+
+   dst->count = n;
+
+   return 0;
+}
+
+void object_pool_clear(struct object_pool *pool)
+{
+   if (pool != NULL)
+      pool->count = 0;
+}
+
+// remember the current transforms, call before moving anything in a step
+void object_pool_save(struct object_pool *pool)
+{
+   if (pool == NULL)
+      return;
+
+   memcpy(pool->last_x, pool->x, sizeof(float) * pool->count);
+   memcpy(pool->last_y, pool->y, sizeof(float) * pool->count);
+   memcpy(pool->last_angle, pool->angle, sizeof(float) * pool->count);
+}
+
+/*
+ * copy transform columns of objects begin to end - 1 into the polygons.
+ * this only marks what changed, vertices get built when something reads
+ * them. ranges can run on different threads.
+ */
+void object_pool_sync_range(struct object_pool *pool, int begin, int end)
+{
+   if (pool == NULL)
+      return;
+
+   for (int i = begin; i < end; i++)
+   {
+      struct polygon *p = &pool->shape[i];
+
+      polygon_set_scale(p, pool->scale[i], pool->scale[i]);
+      polygon_set_angle(p, pool->angle[i]);
+      polygon_translate(p, pool->x[i], pool->y[i]);
+   }
+}
+
+/*
+ * like object_pool_sync_range over the whole pool but alpha of the way
+ * from the saved transforms to the current ones. only for drawing,
+ * collisions need the real transforms.
+ */
+void object_pool_lerp(struct object_pool *pool, float alpha)
+{
+   if (pool == NULL)
+      return;
+
+   for (int i = 0; i < pool->count; i++)
+   {
+      struct polygon *p = &pool->shape[i];
+
+      polygon_set_scale(p, pool->scale[i], pool->scale[i]);
+      polygon_set_angle(p, pool->last_angle[i] + (pool->angle[i] - pool->last_angle[i]) * alpha);
+      polygon_translate(p,
+            pool->last_x[i] + (pool->x[i] - pool->last_x[i]) * alpha,
+            pool->last_y[i] + (pool->y[i] - pool->last_y[i]) * alpha);
+   }
+}
+
+// build vertices of every changed polygon, for when all of them get read
+void object_pool_update(struct object_pool *pool)
+{
+   if (pool != NULL)
+      polygons_update(pool->shape, pool->count);
+}
+
+void object_pool_update_range(struct object_pool *pool, int begin, int end)
+{
+   if (pool != NULL && begin < end)
+      polygons_update(pool->shape + begin, end - begin);
+}
+
+void object_pool_free(struct object_pool *pool)
+{
+   if (pool == NULL)
+      return;
+
+   free(pool->x);
+   free(pool->y);
+   free(pool->vx);
+   free(pool->vy);
+   free(pool->angle);
+   free(pool->scale);
+   free(pool->last_x);
+   free(pool->last_y);
+   free(pool->last_angle);
+   free(pool->outline);
+   free(pool->shape);
+   free(pool->vertices);
+   free(pool->offsets);
+   free(pool->outlines);
+   free(pool->outline_vectors);
+   free(pool->outline_vertices);
+   free(pool->outline_hull);
+
+   memset(pool, 0, sizeof(struct object_pool));
+}
@@ -0,0 +1,71 @@
+/*
+ * Description:
+ * Packed storage for moving polygons with the same number of sides
+ */
+
+#ifndef OBJECT_POOL
+#define OBJECT_POOL
+
+#include "primitives.h"
+
+typedef struct object_pool object_pool;
+
+/*
+ * every column holds count live objects next to each other. removing
+ * an object moves the last one into its place so loops never skip
+ * over holes. columns double in size when they run out of room, which
+ * moves the blocks, so don't hold on to polygon pointers across adds.
+ *
+ * objects don't keep their own outline. outlines get added once with
+ * object_pool_add_outline, their radius and hull are worked out then,
+ * and every object points its polygon at one of them.
+ */
+struct object_pool
+{
+   int count;
+   int capacity;
+   int nsides;
+
+   // transform and movement columns
+   float *x, *y;
+   float *vx, *vy;
+   float *angle;
+   float *scale;
+
+   // transform before the last step, for drawing in between steps
+   float *last_x, *last_y;
+   float *last_angle;
+
+   // outline of each object
+   int *outline;
+
+   // polygon of each object, vectors and hull point into its outline
+   struct polygon *shape;
+
+   // nsides points per object
+   float *vertices;
+   float *offsets;
+
+   // outline polygons at the origin, nsides points or indices per outline
+   struct polygon *outlines;
+   int noutlines;
+   int max_outlines;
+   float *outline_vectors;
+   float *outline_vertices;
+   int *outline_hull;
+};
+
+int object_pool_init          (struct object_pool *pool, int nsides, int capacity);
+int object_pool_add_outline   (struct object_pool *pool, const float *vectors);
+int object_pool_add           (struct object_pool *pool, int outline, float x, float y, float angle, float scale, float vx, float vy);
+int object_pool_remove        (struct object_pool *pool, int index);
+int object_pool_copy          (struct object_pool *dst, const struct object_pool *src);
+void object_pool_clear        (struct object_pool *pool);
+void object_pool_save         (struct object_pool *pool);
+void object_pool_sync_range   (struct object_pool *pool, int begin, int end);
+void object_pool_lerp         (struct object_pool *pool, float alpha);
+void object_pool_update       (struct object_pool *pool);
+void object_pool_update_range (struct object_pool *pool, int begin, int end);
+void object_pool_free         (struct object_pool *pool);
+
+#endif
@@ -1,8 +1,17 @@
 #include <math.h>
 #include "primitives.h"
+#include "fast-math.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define PRIMITIVES_X86_SIMD
+#endif
 
 #define PI 3.1415926535897932384626433832795
 
+// biggest nsides that gets pooled or built on the stack
+#define POLYGON_POOL_SIDES 64
+
 // simple struct for casting
 struct point
 {
@@ -10,7 +19,180 @@ struct point
    float y;
 };
 
-int draw_polygon(SDL_Renderer *renderer, const struct polygon *p)
+static float cross(struct point o, struct point a, struct point b)
+{
+   return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// a before b by x then y
+static int hull_before(const struct point *vectors, int a, int b)
+{
+   return vectors[a].x < vectors[b].x || (vectors[a].x == vectors[b].x && vectors[a].y < vectors[b].y);
+}
+
+/*
+ * bottom up merge sort of n indices by x then y. it's stable so equal
+ * points keep their index order. scratch needs room for n indices.
+ */
+static void hull_sort(const struct point *vectors, int *order, int *scratch, int n)
+{
+   int *from = order;
+   int *to = scratch;
+
+   for (int width = 1; width < n; width *= 2)
+   {
+      for (int lo = 0; lo < n; lo += width * 2)
+      {
+         int mid = lo + width < n ? lo + width : n;
+         int hi = lo + width * 2 < n ? lo + width * 2 : n;
+         int i = lo, j = mid, k = lo;
+
+         while (i < mid && j < hi)
+            to[k++] = hull_before(vectors, from[j], from[i]) ? from[j++] : from[i++];
+         while (i < mid)
+            to[k++] = from[i++];
+         while (j < hi)
+            to[k++] = from[j++];
+      }
+
+      int *swap = from;
+      from = to;
+      to = swap;
+   }
+
+   if (from != order)
+      memcpy(order, from, sizeof(int) * n);
+}
+
+/*
+ * monotone chain convex hull over the vectors. rotating and scaling
+ * keeps the same vertices on the hull so it only gets built once.
+ * returns -1 if big polygons can't get their scratch space.
+ */
+static int polygon_build_hull(struct polygon *p)
+{
+   struct point *vectors = (struct point *)p->vectors;
+   int n = p->nsides;
+
+   // scratch space, only big polygons need the heap
+   int stack_order[POLYGON_POOL_SIDES];
+   int stack_chain[POLYGON_POOL_SIDES + 1];
+   int *order = stack_order;
+   int *chain = stack_chain;
+
+   if (n > POLYGON_POOL_SIDES)
+   {
+      order = (int *)malloc(sizeof(int) * n);
+      chain = (int *)malloc(sizeof(int) * (n + 1));
+
+      if (order == NULL || chain == NULL)
+      {
+         free(order);
+         free(chain);
+         return -1;
+      }
+   }
+
+   // sort indices by x then y, chain isn't used yet so it's the scratch
+   for (int i = 0; i < n; i++)
+      order[i] = i;
+   hull_sort(vectors, order, chain, n);
+
+   int k = 0;
+
+   // lower hull
+   for (int i = 0; i < n; i++)
+   {
+      while (k >= 2 && cross(vectors[chain[k - 2]], vectors[chain[k - 1]], vectors[order[i]]) <= 0)
+         k--;
+      chain[k++] = order[i];
+   }
+
+   // upper hull
+   for (int i = n - 2, t = k + 1; i >= 0; i--)
+   {
+      while (k >= t && cross(vectors[chain[k - 2]], vectors[chain[k - 1]], vectors[order[i]]) <= 0)
+         k--;
+      chain[k++] = order[i];
+   }
+
+   // last point is the same as the first
+   p->nhull = k - 1;
+   for (int i = 0; i < p->nhull; i++)
+      p->hull[i] = chain[i];
+
+   p->convex = p->nhull == n;
+
+   if (n > POLYGON_POOL_SIDES)
+   {
+      free(order);
+      free(chain);
+   }
+
+   return 0;
+}
+
+/*
+ * polygons from the create functions are one block holding the header
+ * followed by vectors, vertices, offsets and hull. freed blocks go on a list
+ * for their nsides and get reused so creating polygons in a running
+ * game doesn't touch the heap. a freed header is reused as the link.
+ * the lists are not thread safe.
+ */
+struct polygon_block
+{
+   struct polygon_block *next;
+};
+
+static struct polygon_block *free_blocks[POLYGON_POOL_SIDES + 1];
+
+static size_t polygon_block_size(int nsides)
+{
+   return sizeof(struct polygon) + sizeof(float) * nsides * 6 + sizeof(int) * nsides;
+}
+
+// get a block with its arrays set up
+static struct polygon *polygon_alloc(int nsides)
+{
+   struct polygon *p;
+
+   if (nsides <= POLYGON_POOL_SIDES && free_blocks[nsides] != NULL)
+   {
+      p = (struct polygon *)free_blocks[nsides];
+      free_blocks[nsides] = free_blocks[nsides]->next;
+   }
+   else
+   {
+      p = (struct polygon *)malloc(polygon_block_size(nsides));
+
+      if (p == NULL)
+         return NULL;
+   }
+
+   p->nsides = nsides;
+   p->vectors = (float *)(p + 1);
+   p->vertices = p->vectors + nsides * 2;
+   p->offsets = p->vertices + nsides * 2;
+   p->hull = (int *)(p->offsets + nsides * 2);
+
+   return p;
+}
+
+// give every free block back to the heap
+void polygon_pool_release()
+{
+   for (int i = 0; i <= POLYGON_POOL_SIDES; i++)
+   {
+      while (free_blocks[i] != NULL)
+      {
+         struct polygon_block *b = free_blocks[i];
+         free_blocks[i] = b->next;
+         free(b);
+      }
+   }
+}
+
+int draw_polygon(SDL_Renderer *renderer, struct polygon *p)
 {
    if (renderer == NULL)
       return -1;
@@ -18,7 +200,20 @@ int draw_polygon(SDL_Renderer *renderer, const struct polygon *p)
    if (p == NULL)
       return -1;
 
-   SDL_FPoint *vertices = (SDL_FPoint *)p->vertices;
+   SDL_FPoint *vertices = (SDL_FPoint *)polygon_vertices(p);
+
+   // repeat the first point so one call closes the outline
+   if (p->nsides <= POLYGON_POOL_SIDES)
+   {
+      SDL_FPoint closed[POLYGON_POOL_SIDES + 1];
+
+      for (int i = 0; i < p->nsides; i++)
+         closed[i] = vertices[i];
+      closed[p->nsides] = vertices[0];
+
+      SDL_RenderDrawLinesF(renderer, closed, p->nsides + 1);
+      return 0;
+   }
 
    SDL_RenderDrawLinesF(renderer, vertices, p->nsides);
    SDL_RenderDrawLineF(renderer,
@@ -28,97 +223,364 @@ int draw_polygon(SDL_Renderer *renderer, const struct polygon *p)
    return 0;
 }
 
-int fpolycmp(const void *a, const void *b)
+// make room for n more quads
+static int line_batch_reserve(struct line_batch *b, int n)
+{
+   if (b->nvertices + n * 4 > b->max_vertices)
+   {
+      int max_vertices = b->max_vertices ? b->max_vertices : 1024;
+      while (max_vertices < b->nvertices + n * 4)
+         max_vertices *= 2;
+
+      SDL_Vertex *vertices = (SDL_Vertex *)realloc(b->vertices, sizeof(SDL_Vertex) * max_vertices);
+      if (vertices == NULL)
+         return -1;
+
+      b->vertices = vertices;
+      b->max_vertices = max_vertices;
+   }
+
+   if (b->nindices + n * 6 > b->max_indices)
+   {
+      int max_indices = b->max_indices ? b->max_indices : 1536;
+      while (max_indices < b->nindices + n * 6)
+         max_indices *= 2;
+
+      int *indices = (int *)realloc(b->indices, sizeof(int) * max_indices);
+      if (indices == NULL)
+         return -1;
+
+      b->indices = indices;
+      b->max_indices = max_indices;
+   }
+
+   return 0;
+}
+
+/*
+ * quad with corners a+n, a-n, b+n, b-n where a and b are the ends of
+ * the line it stands for. room must already be reserved.
+ */
+static void line_batch_quad(struct line_batch *b, float x1, float y1, float x2, float y2, float nx, float ny)
 {
-   return *(float *)a - *(float *)b;
+   SDL_Vertex *v = b->vertices + b->nvertices;
+   int *k = b->indices + b->nindices;
+   int i = b->nvertices;
+
+   v[0].position.x = x1 + nx; v[0].position.y = y1 + ny;
+   v[1].position.x = x1 - nx; v[1].position.y = y1 - ny;
+   v[2].position.x = x2 + nx; v[2].position.y = y2 + ny;
+   v[3].position.x = x2 - nx; v[3].position.y = y2 - ny;
+
+   for (int j = 0; j < 4; j++)
+   {
+      v[j].color = b->color;
+      v[j].tex_coord.x = 0;
+      v[j].tex_coord.y = 0;
+   }
+
+   k[0] = i; k[1] = i + 1; k[2] = i + 2;
+   k[3] = i + 2; k[4] = i + 1; k[5] = i + 3;
+
+   b->nvertices += 4;
+   b->nindices += 6;
 }
 
-int draw_polygon_filled(SDL_Renderer *renderer, const struct polygon *p)
+// one pixel wide line
+static void line_batch_segment(struct line_batch *b, float x1, float y1, float x2, float y2)
 {
-   if (renderer == NULL)
+   float dx = x2 - x1;
+   float dy = y2 - y1;
+   float length = sqrtf(dx * dx + dy * dy);
+
+   if (length == 0)
+      return;
+
+   // half a pixel out to each side
+   line_batch_quad(b, x1, y1, x2, y2, -dy / length * 0.5f, dx / length * 0.5f);
+}
+
+int line_batch_line(struct line_batch *b, float x1, float y1, float x2, float y2)
+{
+   if (b == NULL)
       return -1;
 
-   if (p == NULL)
+   if (line_batch_reserve(b, 1) != 0)
+      return -1;
+
+   line_batch_segment(b, x1, y1, x2, y2);
+
+   return 0;
+}
+
+// add the closed outline of a polygon
+int line_batch_polygon(struct line_batch *b, struct polygon *p)
+{
+   if (b == NULL || p == NULL)
+      return -1;
+
+   if (line_batch_reserve(b, p->nsides) != 0)
+      return -1;
+
+   SDL_FPoint *vertices = (SDL_FPoint *)polygon_vertices(p);
+
+   for (int i = 0, j = p->nsides - 1; i < p->nsides; j = i++)
+      line_batch_segment(b, vertices[j].x, vertices[j].y, vertices[i].x, vertices[i].y);
+
+   return 0;
+}
+
+// draw everything in the batch and empty it
+int line_batch_flush(SDL_Renderer *renderer, struct line_batch *b)
+{
+   if (renderer == NULL || b == NULL)
       return -1;
 
-   struct point *vertices = (struct point *)p->vertices;
+   b->draw_calls = 0;
+   b->drawn_vertices = b->nvertices;
+
+   if (b->nvertices == 0)
+      return 0;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+   b->draw_calls = 1;
+
+   if (SDL_RenderGeometry(renderer, NULL, b->vertices, b->nvertices, b->indices, b->nindices) != 0)
+#endif
+   {
+      // no geometry support so draw the middle of each quad as a line
+      b->draw_calls = 0;
+
+      SDL_Color color = b->vertices[0].color;
+      SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+
+      for (int i = 0; i < b->nvertices; i += 4)
+      {
+         SDL_Vertex *v = b->vertices + i;
+
+         // quads keep the color they were added with
+         if (v[0].color.r != color.r || v[0].color.g != color.g || v[0].color.b != color.b || v[0].color.a != color.a)
+         {
+            color = v[0].color;
+            SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+         }
+
+         SDL_RenderDrawLineF(renderer,
+               (v[0].position.x + v[1].position.x) / 2, (v[0].position.y + v[1].position.y) / 2,
+               (v[2].position.x + v[3].position.x) / 2, (v[2].position.y + v[3].position.y) / 2);
+         b->draw_calls++;
+      }
+   }
+
+   b->nvertices = 0;
+   b->nindices = 0;
 
-   float max_y = vertices[0].y;
-   float min_y = vertices[0].y;
+   return 0;
+}
+
+void line_batch_free(struct line_batch *b)
+{
+   if (b == NULL)
+      return;
+
+   free(b->vertices);
+   free(b->indices);
+
+   b->vertices = NULL;
+   b->indices = NULL;
+   b->nvertices = b->max_vertices = 0;
+   b->nindices = b->max_indices = 0;
+}
+
+/*
+ * active edge table fill. edges are sorted by their first row once,
+ * then each row only steps x along the edges that cross it. rows
+ * sample at pixel centers so touching polygons don't overlap.
+ */
+struct fill_edge
+{
+   int y0;
+   int y1;
+   float x;
+   float dxdy;
+};
+
+static int fill_edge_cmp(const void *a, const void *b)
+{
+   return ((const struct fill_edge *)a)->y0 - ((const struct fill_edge *)b)->y0;
+}
 
-   for (int i = 0; i < p->nsides; i ++)
+// returns -1 if a big polygon can't get its scratch space
+int polygon_spans(struct polygon *p, span_func span, void *data)
+{
+   SDL_FPoint *vertices = (SDL_FPoint *)polygon_vertices(p);
+   int n = p->nsides;
+
+   // scratch space, only big polygons need the heap
+   struct fill_edge stack_edges[POLYGON_POOL_SIDES];
+   struct fill_edge stack_active[POLYGON_POOL_SIDES];
+   struct fill_edge *edges = stack_edges;
+   struct fill_edge *active = stack_active;
+
+   if (n > POLYGON_POOL_SIDES)
    {
-      max_y = vertices[i].y > max_y ? vertices[i].y : max_y;
-      min_y = vertices[i].y < min_y ? vertices[i].y : min_y;
+      edges = (struct fill_edge *)malloc(sizeof(struct fill_edge) * n * 2);
+
+      if (edges == NULL)
+         return -1;
+
+      active = edges + n;
    }
 
-   int nint;
-   float *nodes_x = (float *)malloc(sizeof(float) * p->nsides);
+   int nedges = 0;
 
-   for (int y = min_y; y <= max_y; y++)
+   for (int i = 0, j = n - 1; i < n; j = i++)
    {
-      nint = 0;
+      SDL_FPoint a = vertices[j];
+      SDL_FPoint b = vertices[i];
 
-      //  Build a list of nodes.
-      int ind1;
-      int ind2;
-      for (int i = 0; i < p->nsides; i++)
+      if (a.y > b.y)
       {
-         float x1;
-         float y1;
-         float x2;
-         float y2;
-
-         // get current point at i == 0
-         if (i == 0) {
-            ind1 = p->nsides - 1;
-            ind2 = 0;
-         } else {
-            ind1 = i - 1;
-            ind2 = i;
-         }
+         a = vertices[i];
+         b = vertices[j];
+      }
 
-         y1 = vertices[ind1].y;
-         y2 = vertices[ind2].y;
-         if (y1 < y2) {
-            x1 = vertices[ind1].x;
-            x2 = vertices[ind2].x;
-         } else if (y1 > y2) {
-            y2 = vertices[ind1].y;
-            y1 = vertices[ind2].y;
-            x2 = vertices[ind1].x;
-            x1 = vertices[ind2].x;
-         } else {
-            continue;
-         }
-         if ( ((y >= y1) && (y < y2)) || ((y == max_y) && (y > y1) && (y <= y2)) )
+      struct fill_edge *e = &edges[nedges];
+      e->y0 = (int)ceilf(a.y - 0.5f);
+      e->y1 = (int)ceilf(b.y - 0.5f);
+
+      // horizontal or between two pixel centers
+      if (e->y0 >= e->y1)
+         continue;
+
+      e->dxdy = (b.x - a.x) / (b.y - a.y);
+      e->x = a.x + (e->y0 + 0.5f - a.y) * e->dxdy;
+      nedges++;
+   }
+
+   qsort(edges, nedges, sizeof(struct fill_edge), fill_edge_cmp);
+
+   int next = 0;
+   int nactive = 0;
+
+   for (int y = nedges ? edges[0].y0 : 0; next < nedges || nactive > 0; y++)
+   {
+      // drop finished edges
+      int k = 0;
+      for (int i = 0; i < nactive; i++)
+         if (active[i].y1 > y)
+            active[k++] = active[i];
+      nactive = k;
+
+      // add edges starting on this row
+      while (next < nedges && edges[next].y0 == y)
+         active[nactive++] = edges[next++];
+
+      // edges only swap where they cross so this is nearly sorted
+      for (int i = 1; i < nactive; i++)
+      {
+         struct fill_edge e = active[i];
+         int j = i;
+
+         while (j > 0 && active[j - 1].x > e.x)
          {
-            nodes_x[nint++] = (y - y1) * (x2 - x1) / (y2 - y1) + x1;
+            active[j] = active[j - 1];
+            j--;
          }
-
+         active[j] = e;
       }
 
-      qsort(nodes_x, nint, sizeof(float), fpolycmp);
+      for (int i = 0; i + 1 < nactive; i += 2)
+         span(data, y, active[i].x, active[i + 1].x);
 
-      if (nint % 2 == 0)
-         for (int k = 0; k < nint; k += 2)
-            SDL_RenderDrawLineF(renderer, nodes_x[k], y, nodes_x[k + 1], y);
+      for (int i = 0; i < nactive; i++)
+         active[i].x += active[i].dxdy;
    }
 
-   free(nodes_x);
+   if (n > POLYGON_POOL_SIDES)
+      free(edges);
 
    return 0;
 }
 
-struct polygon *create_polygon(float *input_vectors, int nsides, float x, float y, float angle)
+// spans collected for one SDL_RenderFillRectsF call
+#define FILL_RECTS 256
+
+struct fill_rects
 {
-   if (input_vectors == NULL)
-      return NULL;
+   SDL_Renderer *renderer;
+   SDL_FRect rects[FILL_RECTS];
+   int count;
+};
 
-   if (nsides < 3)
-      return NULL;
+static void fill_rects_span(void *data, int y, float x1, float x2)
+{
+   struct fill_rects *f = (struct fill_rects *)data;
+
+   if (f->count == FILL_RECTS)
+   {
+      SDL_RenderFillRectsF(f->renderer, f->rects, f->count);
+      f->count = 0;
+   }
+
+   SDL_FRect *r = &f->rects[f->count++];
+   r->x = x1;
+   r->y = y;
+   r->w = x2 - x1;
+   r->h = 1;
+}
+
+int draw_polygon_filled(SDL_Renderer *renderer, struct polygon *p)
+{
+   if (renderer == NULL)
+      return -1;
+
+   if (p == NULL)
+      return -1;
+
+   struct fill_rects f;
+   f.renderer = renderer;
+   f.count = 0;
 
-   struct polygon *p = (struct polygon *)malloc(sizeof(struct polygon));
+   int ret = polygon_spans(p, fill_rects_span, &f);
+
+   if (f.count > 0)
+      SDL_RenderFillRectsF(renderer, f.rects, f.count);
+
+   return ret;
+}
+
+static void line_batch_span(void *data, int y, float x1, float x2)
+{
+   struct line_batch *b = (struct line_batch *)data;
+
+   // a failed reserve just drops the span
+   if (line_batch_reserve(b, 1) == 0)
+      line_batch_quad(b, x1, y + 0.5f, x2, y + 0.5f, 0, -0.5f);
+}
+
+// add the spans of a filled polygon
+int line_batch_polygon_filled(struct line_batch *b, struct polygon *p)
+{
+   if (b == NULL || p == NULL)
+      return -1;
+
+   return polygon_spans(p, line_batch_span, b);
+}
+
+/*
+ * set up a polygon in memory owned by the caller. vectors must already
+ * hold nsides points, vertices needs room for nsides points and hull
+ * room for nsides indices. offsets is NULL or room for nsides points,
+ * with it a polygon that only moved doesn't get turned and scaled again.
+ */
+int init_polygon(struct polygon *p, float *vectors, float *vertices, float *offsets, int *hull, int nsides, float x, float y, float angle)
+{
+   if (p == NULL || vectors == NULL || vertices == NULL || hull == NULL)
+      return -1;
+
+   if (nsides < 3)
+      return -1;
 
    // copy stuff
    p->x = x;
@@ -127,68 +589,176 @@ struct polygon *create_polygon(float *input_vectors, int nsides, float x, float
    p->scale.x = 1;
    p->scale.y = 1;
    p->nsides = nsides;
-   p->vectors = (float *)malloc(sizeof(float) * nsides * 2);
-   p->vertices = (float *)malloc(sizeof(float) * nsides * 2);
+   p->vectors = vectors;
+   p->vertices = vertices;
+   p->offsets = offsets;
+   p->hull = hull;
 
-   struct point *vectors = (struct point *)p->vectors;
-   struct point *vertices = (struct point *)p->vertices;
+   // blocks and caller memory can hold anything, offsets and extent aren't built yet
+   p->dirty = POLYGON_DIRTY_ALL;
+
+   struct point *v = (struct point *)p->vectors;
+
+   p->radius = 0;
 
    for (int i = 0; i < p->nsides; i++)
    {
-      // set vectors
-      vectors[i].x = ((struct point *)input_vectors)[i].x;
-      vectors[i].y = ((struct point *)input_vectors)[i].y;
-
-      // set vertices with angle and scale applied
-      vertices[i].x = (float)(p->x + p->scale.x * ((vectors[i].x * cos(p->angle)) - (vectors[i].y * sin(p->angle))));
-      vertices[i].y = (float)(p->y + p->scale.y * ((vectors[i].x * sin(p->angle)) + (vectors[i].y * cos(p->angle))));
+      float length = sqrtf(v[i].x * v[i].x + v[i].y * v[i].y);
+      p->radius = length > p->radius ? length : p->radius;
    }
 
-   return p;
+   if (polygon_build_hull(p) != 0)
+      return -1;
+
+   // set vertices with angle and scale applied
+   polygon_rebuild(p);
+
+   return 0;
 }
 
-struct polygon *create_reg_polygon(int nsides, float x, float y, float angle, float radius)
+struct polygon *create_polygon(float *input_vectors, int nsides, float x, float y, float angle)
 {
+   if (input_vectors == NULL)
+      return NULL;
+
    if (nsides < 3)
       return NULL;
 
-   float *vectors = (float *)malloc(sizeof(float) * nsides * 2);
+   struct polygon *p = polygon_alloc(nsides);
+
+   if (p == NULL)
+      return NULL;
+
+   for (int i = 0; i < nsides * 2; i++)
+      p->vectors[i] = input_vectors[i];
+
+   if (init_polygon(p, p->vectors, p->vertices, p->offsets, p->hull, nsides, x, y, angle) != 0)
+   {
+      free_polygon(p);
+      return NULL;
+   }
+
+   return p;
+}
+
+int reg_polygon_vectors(float *vectors, int nsides, float radius)
+{
+   if (vectors == NULL || nsides < 3)
+      return -1;
 
    float incr_angle = 2.0f * PI / nsides;
 
    for (int i = 0; i < nsides; i++)
    {
+      float s, c;
+      fast_sincosf(i * incr_angle, &s, &c);
+
       // set vectors
-      ((struct point *)vectors)[i].x = (float)(cos(i * incr_angle) * radius);
-      ((struct point *)vectors)[i].y = (float)(sin(i * incr_angle) * radius);
+      ((struct point *)vectors)[i].x = c * radius;
+      ((struct point *)vectors)[i].y = s * radius;
    }
 
-   struct polygon *p = create_polygon(vectors, nsides, x, y, angle);
-   free(vectors);
-   return p;
+   return 0;
 }
 
-struct polygon *create_rand_polygon(int nsides, float x, float y, float angle, float max_radius, float min_radius, float angle_offset)
+/*
+ * same range as rand() but the state belongs to the caller, so every
+ * game can have its own sequence and threads don't share one. it is
+ * a weyl sequence through a hash, any state is fine to start with.
+ */
+int rand_seeded(unsigned int *state)
 {
-   if (nsides < 3)
-      return NULL;
+   Uint32 z = (Uint32)(*state += 0x9e3779b9);
 
-   float *vectors = (float *)malloc(sizeof(float) * nsides * 2);
+   z = (z ^ (z >> 16)) * 0x85ebca6b;
+   z = (z ^ (z >> 13)) * 0xc2b2ae35;
+   z ^= z >> 16;
+
+   return (int)(z % ((unsigned int)RAND_MAX + 1));
+}
+
+// rand() when state is NULL
+static int next_rand(unsigned int *state)
+{
+   return state != NULL ? rand_seeded(state) : rand();
+}
+
+static int fill_rand_vectors(float *vectors, int nsides, float max_radius, float min_radius, float angle_offset, unsigned int *state)
+{
+   if (vectors == NULL || nsides < 3)
+      return -1;
 
    float incr_angle = 2.0f * PI / nsides;
 
    for (int i = 0; i < nsides; i++)
    {
       // set vectors
-      float rand_radius = (float)((double)rand() * (double)((max_radius - min_radius) / RAND_MAX)) + min_radius;
-      float rand_angle = (float)((double)rand() * (double)(((((i + 1) * incr_angle) - i * incr_angle) * angle_offset) / RAND_MAX)) + i * incr_angle;
+      float rand_radius = (float)((double)next_rand(state) * (double)((max_radius - min_radius) / RAND_MAX)) + min_radius;
+      float rand_angle = (float)((double)next_rand(state) * (double)(((((i + 1) * incr_angle) - i * incr_angle) * angle_offset) / RAND_MAX)) + i * incr_angle;
+
+      float s, c;
+      fast_sincosf(rand_angle, &s, &c);
+
+      ((struct point *)vectors)[i].x = c * rand_radius;
+      ((struct point *)vectors)[i].y = s * rand_radius;
+   }
+
+   return 0;
+}
+
+int rand_polygon_vectors(float *vectors, int nsides, float max_radius, float min_radius, float angle_offset)
+{
+   return fill_rand_vectors(vectors, nsides, max_radius, min_radius, angle_offset, NULL);
+}
+
+// rand_polygon_vectors drawing from rand_seeded
+int rand_polygon_vectors_seeded(float *vectors, int nsides, float max_radius, float min_radius, float angle_offset, unsigned int *state)
+{
+   if (state == NULL)
+      return -1;
+
+   return fill_rand_vectors(vectors, nsides, max_radius, min_radius, angle_offset, state);
+}
+
+struct polygon *create_reg_polygon(int nsides, float x, float y, float angle, float radius)
+{
+   if (nsides < 3)
+      return NULL;
 
-      ((struct point *)vectors)[i].x = (float)(cos(rand_angle) * rand_radius);
-      ((struct point *)vectors)[i].y = (float)(sin(rand_angle) * rand_radius);
+   struct polygon *p = polygon_alloc(nsides);
+
+   if (p == NULL)
+      return NULL;
+
+   // build straight into the block
+   reg_polygon_vectors(p->vectors, nsides, radius);
+   if (init_polygon(p, p->vectors, p->vertices, p->offsets, p->hull, nsides, x, y, angle) != 0)
+   {
+      free_polygon(p);
+      return NULL;
+   }
+
+   return p;
+}
+
+struct polygon *create_rand_polygon(int nsides, float x, float y, float angle, float max_radius, float min_radius, float angle_offset)
+{
+   if (nsides < 3)
+      return NULL;
+
+   struct polygon *p = polygon_alloc(nsides);
+
+   if (p == NULL)
+      return NULL;
+
+   // build straight into the block
+   rand_polygon_vectors(p->vectors, nsides, max_radius, min_radius, angle_offset);
+   if (init_polygon(p, p->vectors, p->vertices, p->offsets, p->hull, nsides, x, y, angle) != 0)
+   {
+      free_polygon(p);
+      return NULL;
    }
 
-   struct polygon *p = create_polygon(vectors, nsides, x, y, angle);
-   free(vectors);
    return p;
 }
 
@@ -198,21 +768,171 @@ struct polygon *create_copy_polygon(struct polygon *p)
       return NULL;
 
    struct polygon *p_copy = create_polygon(p->vectors, p->nsides, p->x, p->y, p->angle);
-   p_copy->scale.x = p->scale.x;
-   p_copy->scale.y = p->scale.y;
+   polygon_set_scale(p_copy, p->scale.x, p->scale.y);
 
    return p_copy;
 }
 
-// rebuild floating point polygon
-int polygon_rebuild(struct polygon *p)
+/*
+ * vertex kernels. they take one sin and cos per polygon and do vertices
+ * and bounds in one pass. every kernel does the same float operations
+ * in the same order so they all give the same results.
+ */
+struct transform
 {
-   if (p == NULL)
-      return -1;
+   float c, s;
+   float x, y;
+   float sx, sy;
+};
 
-   struct point *vectors = (struct point *)p->vectors;
-   struct point *vertices = (struct point *)p->vertices;
+static void transform_scalar(const float *in, float *out, int from, int n, const struct transform *t, float *min_x, float *min_y, float *max_x, float *max_y)
+{
+   for (int i = from; i < n; i++)
+   {
+      float x = t->x + t->sx * (in[i * 2] * t->c - in[i * 2 + 1] * t->s);
+      float y = t->y + t->sy * (in[i * 2 + 1] * t->c + in[i * 2] * t->s);
+
+      out[i * 2] = x;
+      out[i * 2 + 1] = y;
+
+      *min_x = x < *min_x ? x : *min_x;
+      *max_x = x > *max_x ? x : *max_x;
+      *min_y = y < *min_y ? y : *min_y;
+      *max_y = y > *max_y ? y : *max_y;
+   }
+}
+
+#ifdef PRIMITIVES_X86_SIMD
+
+/*
+ * points are stored x, y, x, y so one register holds whole points.
+ * swapping x and y in each point lets one multiply add do the rotation:
+ * {x, y} * c + {y, x} * {-s, s}
+ */
+static void transform_sse(const float *in, float *out, int n, const struct transform *t, float *min_x, float *min_y, float *max_x, float *max_y)
+{
+   __m128 vc = _mm_set1_ps(t->c);
+   __m128 vs = _mm_setr_ps(-t->s, t->s, -t->s, t->s);
+   __m128 vp = _mm_setr_ps(t->x, t->y, t->x, t->y);
+   __m128 vk = _mm_setr_ps(t->sx, t->sy, t->sx, t->sy);
+   __m128 lo = _mm_set1_ps(INFINITY);
+   __m128 hi = _mm_set1_ps(-INFINITY);
+
+   int i = 0;
+   for (; i + 2 <= n; i += 2)
+   {
+      __m128 v = _mm_loadu_ps(in + i * 2);
+      __m128 swap = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+      __m128 r = _mm_add_ps(vp, _mm_mul_ps(vk, _mm_add_ps(_mm_mul_ps(v, vc), _mm_mul_ps(swap, vs))));
+
+      _mm_storeu_ps(out + i * 2, r);
+      lo = _mm_min_ps(lo, r);
+      hi = _mm_max_ps(hi, r);
+   }
+
+   float l[4], h[4];
+   _mm_storeu_ps(l, lo);
+   _mm_storeu_ps(h, hi);
+
+   *min_x = l[0] < l[2] ? l[0] : l[2];
+   *min_y = l[1] < l[3] ? l[1] : l[3];
+   *max_x = h[0] > h[2] ? h[0] : h[2];
+   *max_y = h[1] > h[3] ? h[1] : h[3];
+
+   transform_scalar(in, out, i, n, t, min_x, min_y, max_x, max_y);
+}
+
+// same as transform_sse with 4 points at a time
+__attribute__((target("avx")))
+static void transform_avx(const float *in, float *out, int n, const struct transform *t, float *min_x, float *min_y, float *max_x, float *max_y)
+{
+   __m256 vc = _mm256_set1_ps(t->c);
+   __m256 vs = _mm256_setr_ps(-t->s, t->s, -t->s, t->s, -t->s, t->s, -t->s, t->s);
+   __m256 vp = _mm256_setr_ps(t->x, t->y, t->x, t->y, t->x, t->y, t->x, t->y);
+   __m256 vk = _mm256_setr_ps(t->sx, t->sy, t->sx, t->sy, t->sx, t->sy, t->sx, t->sy);
+   __m256 lo = _mm256_set1_ps(INFINITY);
+   __m256 hi = _mm256_set1_ps(-INFINITY);
+
+   int i = 0;
+   for (; i + 4 <= n; i += 4)
+   {
+      __m256 v = _mm256_loadu_ps(in + i * 2);
+      __m256 swap = _mm256_permute_ps(v, _MM_SHUFFLE(2, 3, 0, 1));
+      __m256 r = _mm256_add_ps(vp, _mm256_mul_ps(vk, _mm256_add_ps(_mm256_mul_ps(v, vc), _mm256_mul_ps(swap, vs))));
+
+      _mm256_storeu_ps(out + i * 2, r);
+      lo = _mm256_min_ps(lo, r);
+      hi = _mm256_max_ps(hi, r);
+   }
+
+   float l[8], h[8];
+   _mm256_storeu_ps(l, lo);
+   _mm256_storeu_ps(h, hi);
+
+   // the scalar tail is plain sse, dirty upper halves would slow it down
+   _mm256_zeroupper();
+
+   *min_x = *min_y = INFINITY;
+   *max_x = *max_y = -INFINITY;
+
+   for (int k = 0; k < 8; k += 2)
+   {
+      *min_x = l[k] < *min_x ? l[k] : *min_x;
+      *min_y = l[k + 1] < *min_y ? l[k + 1] : *min_y;
+      *max_x = h[k] > *max_x ? h[k] : *max_x;
+      *max_y = h[k + 1] > *max_y ? h[k + 1] : *max_y;
+   }
 
+   transform_scalar(in, out, i, n, t, min_x, min_y, max_x, max_y);
+}
+
+#endif
+
+#ifdef PRIMITIVES_X86_SIMD
+// vertex kernel, 1 for sse and 2 for avx. only primitives_init sets it
+static int simd = 1;
+#endif
+
+// pick the kernels for this cpu, call before starting any threads
+void primitives_init()
+{
+#ifdef PRIMITIVES_X86_SIMD
+   simd = SDL_HasAVX() ? 2 : 1;
+#endif
+}
+
+// vertices at the current position from the offsets, bounds follow from extent
+static void polygon_offset(struct polygon *p)
+{
+   int i = 0;
+
+#ifdef PRIMITIVES_X86_SIMD
+   __m128 vp = _mm_setr_ps(p->x, p->y, p->x, p->y);
+
+   for (; i + 2 <= p->nsides; i += 2)
+      _mm_storeu_ps(p->vertices + i * 2, _mm_add_ps(vp, _mm_loadu_ps(p->offsets + i * 2)));
+#endif
+
+   for (; i < p->nsides; i++)
+   {
+      p->vertices[i * 2] = p->x + p->offsets[i * 2];
+      p->vertices[i * 2 + 1] = p->y + p->offsets[i * 2 + 1];
+   }
+
+   p->bounds.min_x = p->x + p->extent.min_x;
+   p->bounds.min_y = p->y + p->extent.min_y;
+   p->bounds.max_x = p->x + p->extent.max_x;
+   p->bounds.max_y = p->y + p->extent.max_y;
+}
+
+/*
+ * build vertices, bounds and extent from the current transform. with
+ * offsets the outline gets turned and scaled into them around the
+ * origin and then moved, which rounds the same as doing both at once.
+ * a polygon that only moved since then just gets moved again.
+ */
+static void polygon_transform(struct polygon *p)
+{
    /*
     * 2d rotation matrix
     * 
@@ -227,31 +947,167 @@ int polygon_rebuild(struct polygon *p)
     *		 { 0, Sy }
     */
 
-   for (int i = 0; i < p->nsides; i++)
+   if (p->offsets != NULL && p->dirty == POLYGON_DIRTY_POSITION)
+   {
+      polygon_offset(p);
+      p->dirty = 0;
+      return;
+   }
+
+   float s, c;
+   fast_sincosf(p->angle, &s, &c);
+
+   float *out = p->offsets != NULL ? p->offsets : p->vertices;
+   float x = p->offsets != NULL ? 0 : p->x;
+   float y = p->offsets != NULL ? 0 : p->y;
+
+   struct transform t = { c, s, x, y, p->scale.x, p->scale.y };
+   float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+
+#ifdef PRIMITIVES_X86_SIMD
+   // small polygons would mostly run the scalar tail of the avx kernel
+   if (simd == 2 && p->nsides >= 8)
+      transform_avx(p->vectors, out, p->nsides, &t, &min_x, &min_y, &max_x, &max_y);
+   else
+      transform_sse(p->vectors, out, p->nsides, &t, &min_x, &min_y, &max_x, &max_y);
+#else
+   transform_scalar(p->vectors, out, 0, p->nsides, &t, &min_x, &min_y, &max_x, &max_y);
+#endif
+
+   p->extent.min_x = min_x - x;
+   p->extent.min_y = min_y - y;
+   p->extent.max_x = max_x - x;
+   p->extent.max_y = max_y - y;
+
+   if (p->offsets != NULL)
+   {
+      polygon_offset(p);
+   }
+   else
    {
-      vertices[i].x = (float)(p->x + p->scale.x * ((vectors[i].x * cos(p->angle)) - (vectors[i].y * sin(p->angle))));
-      vertices[i].y = (float)(p->y + p->scale.y * ((vectors[i].x * sin(p->angle)) + (vectors[i].y * cos(p->angle))));
+      p->bounds.min_x = min_x;
+      p->bounds.min_y = min_y;
+      p->bounds.max_x = max_x;
+      p->bounds.max_y = max_y;
    }
 
+   p->dirty = 0;
+}
+
+// bounds that hold the polygon whatever its angle and scale are
+static void polygon_circle_bounds(struct polygon *p)
+{
+   float r = polygon_bounding_radius(p);
+
+   p->bounds.min_x = p->x - r;
+   p->bounds.min_y = p->y - r;
+   p->bounds.max_x = p->x + r;
+   p->bounds.max_y = p->y + r;
+}
+
+/*
+ * rebuild floating point polygon now whether it changed or not. the
+ * transform may have been written directly so the offsets can't be
+ * trusted either.
+ */
+int polygon_rebuild(struct polygon *p)
+{
+   if (p == NULL)
+      return -1;
+
+   p->dirty = POLYGON_DIRTY_ALL;
+   polygon_transform(p);
+
    return 0;
 }
 
-int polygon_translate(struct polygon *p, float x, float y)
+/*
+ * one pass over a packed array. each polygon takes one sincos and its
+ * points go through the kernel 2 or 4 at a time, so lanes are already
+ * full for astroid sized polygons.
+ */
+int polygons_rebuild(struct polygon *polygons, int count)
+{
+   if (polygons == NULL)
+      return -1;
+
+   for (int i = 0; i < count; i++)
+   {
+      polygons[i].dirty = POLYGON_DIRTY_ALL;
+      polygon_transform(&polygons[i]);
+   }
+
+   return 0;
+}
+
+// rebuild floating point polygon if its transform changed
+int polygon_update(struct polygon *p)
 {
    if (p == NULL)
       return -1;
 
-   struct point *vertices = (struct point *)p->vertices;
+   if (p->dirty)
+      polygon_transform(p);
 
-   for (int i = 0; i < p->nsides; i++)
+   return 0;
+}
+
+int polygons_update(struct polygon *polygons, int count)
+{
+   if (polygons == NULL)
+      return -1;
+
+   for (int i = 0; i < count; i++)
    {
-      vertices[i].x = vertices[i].x - p->x + x;
-      vertices[i].y = vertices[i].y - p->y + y;
+      if (polygons[i].dirty)
+         polygon_transform(&polygons[i]);
    }
 
+   return 0;
+}
+
+// up to date world space vertices
+float *polygon_vertices(struct polygon *p)
+{
+   if (p == NULL)
+      return NULL;
+
+   if (p->dirty)
+      polygon_transform(p);
+
+   return p->vertices;
+}
+
+/*
+ * the set functions only mark what changed. a moved polygon keeps
+ * exact bounds by offsetting its extent, after a turn or scale the
+ * bounds fall back to a box around the bounding circle until the
+ * vertices get built again. only moving is cheap to build for polygons
+ * with offsets, see polygon_transform.
+ */
+int polygon_translate(struct polygon *p, float x, float y)
+{
+   if (p == NULL)
+      return -1;
+
+   if (p->x == x && p->y == y)
+      return 0;
+
    // store new position
    p->x = x;
    p->y = y;
+   p->dirty |= POLYGON_DIRTY_POSITION;
+
+   if (p->dirty & (POLYGON_DIRTY_ANGLE | POLYGON_DIRTY_SCALE))
+   {
+      polygon_circle_bounds(p);
+      return 0;
+   }
+
+   p->bounds.min_x = x + p->extent.min_x;
+   p->bounds.min_y = y + p->extent.min_y;
+   p->bounds.max_x = x + p->extent.max_x;
+   p->bounds.max_y = y + p->extent.max_y;
 
    return 0;
 }
@@ -261,9 +1117,13 @@ int polygon_set_angle(struct polygon *p, float angle)
    if (p == NULL)
       return -1;
 
+   if (p->angle == angle)
+      return 0;
+
    p->angle = angle;
+   p->dirty |= POLYGON_DIRTY_ANGLE;
 
-   polygon_rebuild(p);
+   polygon_circle_bounds(p);
 
    return 0;
 }
@@ -273,23 +1133,63 @@ int polygon_set_scale(struct polygon *p, float scale_x, float scale_y)
    if (p == NULL)
       return -1;
 
-   struct point *vertices = (struct point *)p->vertices;
+   if (p->scale.x == scale_x && p->scale.y == scale_y)
+      return 0;
 
-   for (int i = 0; i < p->nsides; i++)
-   {
-      vertices[i].x = (vertices[i].x - p->x) / p->scale.x * scale_x + p->x;
-      vertices[i].y = (vertices[i].y - p->y) / p->scale.y * scale_y + p->y;
-   }
+   p->scale.x = scale_x;
+   p->scale.y = scale_y;
+   p->dirty |= POLYGON_DIRTY_SCALE;
+
+   polygon_circle_bounds(p);
+
+   return 0;
+}
 
+// set the whole transform of a polygon whose vertices are for some other transform
+int polygon_set_transform(struct polygon *p, float x, float y, float angle, float scale_x, float scale_y)
+{
+   if (p == NULL)
+      return -1;
+
+   p->x = x;
+   p->y = y;
+   p->angle = angle;
    p->scale.x = scale_x;
    p->scale.y = scale_y;
+   p->dirty = POLYGON_DIRTY_ALL;
+
+   polygon_circle_bounds(p);
 
    return 0;
 }
 
+// radius of a circle around the polygon position that holds every vertex
+float polygon_bounding_radius(const struct polygon *p)
+{
+   if (p == NULL)
+      return 0;
+
+   float sx = fabsf(p->scale.x);
+   float sy = fabsf(p->scale.y);
+
+   return p->radius * (sx > sy ? sx : sy);
+}
+
+// only for polygons from the create functions, goes back to the pool
 void free_polygon(struct polygon *p)
 {
-   free(p->vectors);
-   free(p->vertices);
-   free(p);
+   if (p == NULL)
+      return;
+
+   if (p->nsides > POLYGON_POOL_SIDES)
+   {
+      free(p);
+      return;
+   }
+
+   struct polygon_block *b = (struct polygon_block *)p;
+   int nsides = p->nsides;
+
+   b->next = free_blocks[nsides];
+   free_blocks[nsides] = b;
 }
@@ -8,8 +8,18 @@
 
 #include <SDL2/SDL.h>
 
+// parts of a transform that changed since the vertices were built
+#define POLYGON_DIRTY_POSITION   1
+#define POLYGON_DIRTY_ANGLE      2
+#define POLYGON_DIRTY_SCALE      4
+#define POLYGON_DIRTY_ALL        (POLYGON_DIRTY_POSITION | POLYGON_DIRTY_ANGLE | POLYGON_DIRTY_SCALE)
+
 typedef struct polygon polygon;
 typedef struct ellipse ellipse;
+typedef struct line_batch line_batch;
+
+// called for each row of a filled polygon, x1 <= x2
+typedef void (*span_func)(void *data, int y, float x1, float x2);
 
 struct polygon
 {
@@ -20,7 +30,27 @@ struct polygon
    float *vectors;
    float *vertices;
 
+   // vertices turned and scaled but not moved, NULL if there's no room for them
+   float *offsets;
+
    struct { float x, y; } scale;
+
+   // distance of the furthest vector from the center before scaling
+   float radius;
+
+   // world space box around vertices
+   struct { float min_x, min_y, max_x, max_y; } bounds;
+
+   // box around vertices relative to the position they were built at
+   struct { float min_x, min_y, max_x, max_y; } extent;
+
+   // see POLYGON_DIRTY_*, vertices are stale when set
+   char dirty;
+
+   // indices of the vertices on the convex hull
+   int *hull;
+   int nhull;
+   char convex;
 };
 
 struct ellipse
@@ -32,9 +62,44 @@ struct ellipse
    struct { float x, y; } radius;
 };
 
+/*
+ * collects the lines of a whole frame and draws them with as few
+ * renderer calls as possible. each line becomes a thin quad so they
+ * all fit in one SDL_RenderGeometry call, filled polygons add a quad
+ * per span. a zeroed batch is ready to use, set color before adding
+ * lines.
+ */
+struct line_batch
+{
+   SDL_Color color;
+
+   SDL_Vertex *vertices;
+   int nvertices;
+   int max_vertices;
+
+   int *indices;
+   int nindices;
+   int max_indices;
+
+   // stats from the last flush
+   int draw_calls;
+   int drawn_vertices;
+};
+
+// pick the fastest kernels the cpu has, sse until called
+void primitives_init                   ();
+
 // float polygons
-int draw_polygon                       (SDL_Renderer *renderer, const struct polygon *p);
-int draw_polygon_filled                (SDL_Renderer *renderer, const struct polygon *p);
+int draw_polygon                       (SDL_Renderer *renderer, struct polygon *p);
+int draw_polygon_filled                (SDL_Renderer *renderer, struct polygon *p);
+int polygon_spans                      (struct polygon *p, span_func span, void *data);
+
+// batched lines
+int line_batch_line                    (struct line_batch *b, float x1, float y1, float x2, float y2);
+int line_batch_polygon                 (struct line_batch *b, struct polygon *p);
+int line_batch_polygon_filled          (struct line_batch *b, struct polygon *p);
+int line_batch_flush                   (SDL_Renderer *renderer, struct line_batch *b);
+void line_batch_free                   (struct line_batch *b);
 
 // build float polygons
 struct polygon *create_polygon         (float *input_vectors, int nsides, float x, float y, float angle);
@@ -42,13 +107,36 @@ struct polygon *create_reg_polygon     (int nsides, float x, float y, float angl
 struct polygon *create_rand_polygon    (int nsides, float x, float y, float angle, float max_radius, float min_radius, float angle_offset);
 struct polygon *create_copy_polygon    (struct polygon *p);
 
-// transform float polygon
+// build float polygons in caller owned memory
+int init_polygon                       (struct polygon *p, float *vectors, float *vertices, float *offsets, int *hull, int nsides, float x, float y, float angle);
+int reg_polygon_vectors                (float *vectors, int nsides, float radius);
+int rand_polygon_vectors               (float *vectors, int nsides, float max_radius, float min_radius, float angle_offset);
+int rand_polygon_vectors_seeded        (float *vectors, int nsides, float max_radius, float min_radius, float angle_offset, unsigned int *state);
+int rand_seeded                        (unsigned int *state);
+
+/*
+ * transform float polygon. the set functions and translate only mark
+ * the polygon dirty, vertices get built when drawing, collision or
+ * polygon_vertices read them. code that writes x, y, angle or scale
+ * directly has to call polygon_rebuild.
+ */
 int polygon_rebuild                    (struct polygon *p);
+int polygons_rebuild                   (struct polygon *polygons, int count);
+int polygon_update                     (struct polygon *p);
+int polygons_update                    (struct polygon *polygons, int count);
+float *polygon_vertices                (struct polygon *p);
 int polygon_translate                  (struct polygon *p, float x, float y);
 int polygon_set_angle                  (struct polygon *p, float angle);
 int polygon_set_scale                  (struct polygon *p, float scale_x, float scale_y);
+int polygon_set_transform              (struct polygon *p, float x, float y, float angle, float scale_x, float scale_y);
+
+// float polygon bounds
+float polygon_bounding_radius          (const struct polygon *p);
 
 // free float polygon
 void free_polygon                      (struct polygon *p);
 
+// reuse freed polygon memory
+void polygon_pool_release              ();
+
 #endif
@@ -0,0 +1,289 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profiler.h"
+
+struct profiler profiler;
+
+static const char *phase_names[PROFILE_PHASES] =
+{
+   "events",
+   "move",
+   "rebuild",
+   "collide_ship",
+   "collide_bullets",
+   "render",
+   "present",
+};
+
+static const SDL_Color phase_colors[PROFILE_PHASES] =
+{
+   { 255, 255, 255, 255 },
+   { 0, 200, 255, 255 },
+   { 0, 255, 100, 255 },
+   { 255, 200, 0, 255 },
+   { 255, 100, 0, 255 },
+   { 200, 100, 255, 255 },
+   { 255, 0, 150, 255 },
+};
+
+// starts disabled, timers cost nothing until enabled is set
+void profiler_init(struct profiler *p)
+{
+   memset(p, 0, sizeof(*p));
+
+   p->frequency = SDL_GetPerformanceFrequency();
+   p->frame_start = SDL_GetPerformanceCounter();
+}
+
+void profile_begin(enum profile_phase phase)
+{
+   if (profiler.enabled)
+      profiler.start[phase] = SDL_GetPerformanceCounter();
+}
+
+void profile_end(enum profile_phase phase)
+{
+   if (!profiler.enabled)
+      return;
+
+   Uint64 ticks = SDL_GetPerformanceCounter() - profiler.start[phase];
+   SDL_AtomicAdd(&profiler.current[phase], (int)(ticks * 1000000 / profiler.frequency));
+}
+
+// close the current frame and push it into the ring
+void profiler_frame(struct profiler *p)
+{
+   if (!p->enabled)
+      return;
+
+   Uint64 now = SDL_GetPerformanceCounter();
+   struct profile_frame *f = &p->frames[p->head];
+
+   f->frame_ms = (float)((double)(now - p->frame_start) * 1000.0 / p->frequency);
+   p->frame_start = now;
+
+   for (int i = 0; i < PROFILE_PHASES; i++)
+      f->phase_ms[i] = SDL_AtomicSet(&p->current[i], 0) / 1000.0f;
+
+   f->input_ms = p->current_input;
+   p->current_input = 0;
+
+   p->head = (p->head + 1) % PROFILER_FRAMES;
+   if (p->count < PROFILER_FRAMES)
+      p->count++;
+}
+
+// input latency of the current frame, called from the thread that calls profiler_frame
+void profiler_input(struct profiler *p, float ms)
+{
+   if (p->enabled && ms > p->current_input)
+      p->current_input = ms;
+}
+
+static int floatcmp(const void *a, const void *b)
+{
+   float x = *(const float *)a;
+   float y = *(const float *)b;
+
+   return (x > y) - (x < y);
+}
+
+// sorts ms in place
+static void percentiles(float *ms, int n, float *median, float *p99, float *max)
+{
+   *median = *p99 = *max = 0;
+
+   if (n == 0)
+      return;
+
+   qsort(ms, n, sizeof(float), floatcmp);
+
+   *median = ms[n / 2];
+   *p99 = ms[(n - 1) * 99 / 100];
+   *max = ms[n - 1];
+}
+
+// latency over the frames in the ring that showed input, returns how many did
+int profiler_input_stats(struct profiler *p, float *median, float *p99, float *max)
+{
+   float ms[PROFILER_FRAMES];
+   int n = 0;
+
+   for (int age = 0; age < p->count; age++)
+   {
+      struct profile_frame *f = profiler_get(p, age);
+
+      if (f->input_ms > 0)
+         ms[n++] = f->input_ms;
+   }
+
+   percentiles(ms, n, median, p99, max);
+
+   return n;
+}
+
+/*
+ * frame times over the ring. jitter is the standard deviation, how
+ * evenly frames come out no matter how long they are. the oldest
+ * frame is skipped, it covers startup. returns the frames used.
+ */
+int profiler_frame_stats(struct profiler *p, float *median, float *p99, float *max, float *jitter)
+{
+   float ms[PROFILER_FRAMES];
+   int n = p->count > 1 ? p->count - 1 : 0;
+   double sum = 0, sum2 = 0;
+
+   for (int age = 0; age < n; age++)
+   {
+      ms[age] = profiler_get(p, age)->frame_ms;
+      sum += ms[age];
+      sum2 += (double)ms[age] * ms[age];
+   }
+
+   *jitter = 0;
+
+   if (n > 0)
+   {
+      double mean = sum / n;
+      double variance = sum2 / n - mean * mean;
+
+      *jitter = variance > 0 ? (float)sqrt(variance) : 0;
+   }
+
+   percentiles(ms, n, median, p99, max);
+
+   return n;
+}
+
+// age 0 is the newest frame, NULL past the oldest
+struct profile_frame *profiler_get(struct profiler *p, int age)
+{
+   if (age < 0 || age >= p->count)
+      return NULL;
+
+   return &p->frames[(p->head - 1 - age + PROFILER_FRAMES) % PROFILER_FRAMES];
+}
+
+const char *profile_phase_name(int phase)
+{
+   return phase >= 0 && phase < PROFILE_PHASES ? phase_names[phase] : "unknown";
+}
+
+/*
+ * histogram of the frame times in the ring with a red line at 60 fps,
+ * under it a bar of the average time of each phase on the same scale.
+ */
+int profiler_overlay(struct profiler *p, struct line_batch *b, float x, float y, float height)
+{
+   if (p->count == 0)
+      return 0;
+
+   int buckets[PROFILER_BUCKETS] = { 0 };
+   float average[PROFILE_PHASES] = { 0 };
+   int most = 1;
+
+   for (int age = 0; age < p->count; age++)
+   {
+      struct profile_frame *f = profiler_get(p, age);
+      int k = (int)f->frame_ms;
+
+      k = k < 0 ? 0 : k >= PROFILER_BUCKETS ? PROFILER_BUCKETS - 1 : k;
+      if (++buckets[k] > most)
+         most = buckets[k];
+
+      for (int i = 0; i < PROFILE_PHASES; i++)
+         average[i] += f->phase_ms[i] / p->count;
+   }
+
+   // each bucket is a bar 3 pixels wide
+   SDL_Color color = b->color;
+   b->color = (SDL_Color){ 0, 255, 0, 255 };
+
+   for (int k = 0; k < PROFILER_BUCKETS; k++)
+   {
+      float top = y + height - height * buckets[k] / most;
+
+      for (int i = 0; i < 3 && buckets[k] > 0; i++)
+         if (line_batch_line(b, x + k * 4 + i, y + height, x + k * 4 + i, top) != 0)
+            return -1;
+   }
+
+   b->color = (SDL_Color){ 255, 0, 0, 255 };
+   line_batch_line(b, x + 4 * 1000.0f / 60.0f, y, x + 4 * 1000.0f / 60.0f, y + height);
+
+   float bar_x = x;
+
+   for (int i = 0; i < PROFILE_PHASES; i++)
+   {
+      b->color = phase_colors[i];
+
+      for (int j = 0; j < 3; j++)
+         line_batch_line(b, bar_x, y + height + 4 + j, bar_x + average[i] * 4, y + height + 4 + j);
+
+      bar_x += average[i] * 4;
+   }
+
+   b->color = color;
+
+   return 0;
+}
+
+static void write_csv(struct profiler *p, FILE *file)
+{
+   fprintf(file, "frame,frame_ms");
+   for (int i = 0; i < PROFILE_PHASES; i++)
+      fprintf(file, ",%s", phase_names[i]);
+   fprintf(file, ",input_ms\n");
+
+   // oldest first
+   for (int age = p->count - 1; age >= 0; age--)
+   {
+      struct profile_frame *f = profiler_get(p, age);
+
+      fprintf(file, "%d,%.3f", p->count - 1 - age, f->frame_ms);
+      for (int i = 0; i < PROFILE_PHASES; i++)
+         fprintf(file, ",%.3f", f->phase_ms[i]);
+      fprintf(file, ",%.3f\n", f->input_ms);
+   }
+}
+
+static void write_json(struct profiler *p, FILE *file)
+{
+   fprintf(file, "{\n  \"phases\": [");
+   for (int i = 0; i < PROFILE_PHASES; i++)
+      fprintf(file, "%s\"%s\"", i ? ", " : "", phase_names[i]);
+   fprintf(file, "],\n  \"frames\": [\n");
+
+   for (int age = p->count - 1; age >= 0; age--)
+   {
+      struct profile_frame *f = profiler_get(p, age);
+
+      fprintf(file, "    { \"frame_ms\": %.3f, \"phase_ms\": [", f->frame_ms);
+      for (int i = 0; i < PROFILE_PHASES; i++)
+         fprintf(file, "%s%.3f", i ? ", " : "", f->phase_ms[i]);
+      fprintf(file, "], \"input_ms\": %.3f }%s\n", f->input_ms, age ? "," : "");
+   }
+
+   fprintf(file, "  ]\n}\n");
+}
+
+// json when the path ends in .json, csv otherwise
+int profiler_write(struct profiler *p, const char *path)
+{
+   FILE *file = fopen(path, "w");
+
+   if (file == NULL)
+      return -1;
+
+   size_t len = strlen(path);
+   int json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+
+   if (json)
+      write_json(p, file);
+   else
+      write_csv(p, file);
+
+   return fclose(file) == 0 ? 0 : -1;
+}
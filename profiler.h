@@ -0,0 +1,77 @@
+/*
+ * Description:
+ * Timers for the phases of a frame, kept in a ring of recent frames
+ */
+
+#ifndef PROFILER
+#define PROFILER
+
+#include <SDL2/SDL.h>
+#include "primitives.h"
+
+// frames kept for the overlay and the dump, about a minute at 60 fps
+#define PROFILER_FRAMES     4096
+
+// overlay histogram buckets, one millisecond each
+#define PROFILER_BUCKETS    50
+
+enum profile_phase
+{
+   PROFILE_EVENTS,
+   PROFILE_MOVE,
+   PROFILE_REBUILD,
+   PROFILE_COLLIDE_SHIP,
+   PROFILE_COLLIDE_BULLETS,
+   PROFILE_RENDER,
+   PROFILE_PRESENT,
+   PROFILE_PHASES
+};
+
+struct profile_frame
+{
+   float frame_ms;
+   float phase_ms[PROFILE_PHASES];
+
+   // from the oldest key change the frame shows to its present, 0 for none
+   float input_ms;
+};
+
+/*
+ * a phase is only ever timed by one thread. its time adds up in
+ * current until profiler_frame moves it into the ring, so phases of
+ * the sim thread land in the frame they finished in and can show up
+ * zero or several times a frame.
+ */
+struct profiler
+{
+   char enabled;
+   Uint64 frequency;
+
+   Uint64 start[PROFILE_PHASES];
+
+   // microseconds this frame
+   SDL_atomic_t current[PROFILE_PHASES];
+   float current_input;
+   Uint64 frame_start;
+
+   // newest frame is at head - 1
+   struct profile_frame frames[PROFILER_FRAMES];
+   int head;
+   int count;
+};
+
+extern struct profiler profiler;
+
+void profiler_init                  (struct profiler *p);
+void profile_begin                  (enum profile_phase phase);
+void profile_end                    (enum profile_phase phase);
+void profiler_frame                 (struct profiler *p);
+void profiler_input                 (struct profiler *p, float ms);
+int profiler_input_stats            (struct profiler *p, float *median, float *p99, float *max);
+int profiler_frame_stats            (struct profiler *p, float *median, float *p99, float *max, float *jitter);
+struct profile_frame *profiler_get  (struct profiler *p, int age);
+const char *profile_phase_name      (int phase);
+int profiler_overlay                (struct profiler *p, struct line_batch *b, float x, float y, float height);
+int profiler_write                  (struct profiler *p, const char *path);
+
+#endif
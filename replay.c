@@ -0,0 +1,266 @@
+#include <string.h>
+#include "replay.h"
+
+// record ops
+#define OP_KEY_UP       0
+#define OP_KEY_DOWN     1
+#define OP_DELTA_T      2
+#define OP_END          3
+
+static void write_u32(FILE *file, Uint32 v)
+{
+   for (int i = 0; i < 4; i++)
+      fputc((v >> (i * 8)) & 0xff, file);
+}
+
+static void write_double(FILE *file, double d)
+{
+   Uint64 v;
+   memcpy(&v, &d, sizeof(v));
+
+   for (int i = 0; i < 8; i++)
+      fputc((int)(v >> (i * 8)) & 0xff, file);
+}
+
+static void write_varint(FILE *file, unsigned long v)
+{
+   while (v >= 0x80)
+   {
+      fputc((v & 0x7f) | 0x80, file);
+      v >>= 7;
+   }
+
+   fputc((int)v, file);
+}
+
+static int read_u32(FILE *file, Uint32 *v)
+{
+   *v = 0;
+
+   for (int i = 0; i < 4; i++)
+   {
+      int c = fgetc(file);
+      if (c == EOF)
+         return -1;
+      *v |= (Uint32)c << (i * 8);
+   }
+
+   return 0;
+}
+
+static int read_double(FILE *file, double *d)
+{
+   Uint64 v = 0;
+
+   for (int i = 0; i < 8; i++)
+   {
+      int c = fgetc(file);
+      if (c == EOF)
+         return -1;
+      v |= (Uint64)c << (i * 8);
+   }
+
+   memcpy(d, &v, sizeof(v));
+
+   return 0;
+}
+
+static int read_varint(FILE *file, unsigned long *v)
+{
+   *v = 0;
+
+   for (int shift = 0; shift < 64; shift += 7)
+   {
+      int c = fgetc(file);
+      if (c == EOF)
+         return -1;
+
+      *v |= (unsigned long)(c & 0x7f) << shift;
+
+      if (!(c & 0x80))
+         return 0;
+   }
+
+   return -1;
+}
+
+static void write_record(struct replay *r, int op)
+{
+   write_varint(r->file, r->tick - r->last);
+   fputc(op, r->file);
+   r->last = r->tick;
+}
+
+// read the next record, a cut off file ends where it was cut
+static void read_record(struct replay *r)
+{
+   unsigned long gap;
+   int op = EOF;
+
+   if (read_varint(r->file, &gap) == 0)
+      op = fgetc(r->file);
+
+   if (op == OP_KEY_UP || op == OP_KEY_DOWN)
+   {
+      int low = fgetc(r->file);
+      int high = fgetc(r->file);
+
+      r->key = low | high << 8;
+
+      if (low == EOF || high == EOF || r->key >= SDL_NUM_SCANCODES)
+         op = EOF;
+   }
+   else if (op == OP_DELTA_T && read_double(r->file, &r->next_delta_t) != 0)
+      op = EOF;
+   else if (op != OP_DELTA_T && op != OP_END)
+      op = EOF;
+
+   if (op == EOF)
+   {
+      r->op = OP_END;
+      r->next = r->last;
+      return;
+   }
+
+   r->op = op;
+   r->next = r->last + gap;
+   r->last = r->next;
+}
+
+static int replay_open(struct replay *r, const char *path, const char *mode)
+{
+   memset(r, 0, sizeof(*r));
+
+   r->file = fopen(path, mode);
+
+   if (r->file == NULL)
+      return -1;
+
+   return 0;
+}
+
+int replay_record(struct replay *r, const char *path, struct replay_header *header)
+{
+   if (r == NULL || header == NULL || replay_open(r, path, "wb") != 0)
+      return -1;
+
+   r->mode = REPLAY_RECORD;
+   r->header = *header;
+   r->delta_t = header->delta_t;
+
+   write_u32(r->file, REPLAY_MAGIC);
+   write_u32(r->file, REPLAY_VERSION);
+   write_u32(r->file, header->seed);
+   write_double(r->file, header->delta_t);
+
+   for (int i = 0; i < REPLAY_USER; i++)
+      write_u32(r->file, (Uint32)header->user[i]);
+
+   return 0;
+}
+
+int replay_play(struct replay *r, const char *path)
+{
+   if (r == NULL || replay_open(r, path, "rb") != 0)
+      return -1;
+
+   Uint32 magic, version, seed, user;
+   int ok = read_u32(r->file, &magic) == 0 && read_u32(r->file, &version) == 0 &&
+         magic == REPLAY_MAGIC && version == REPLAY_VERSION &&
+         read_u32(r->file, &seed) == 0 && read_double(r->file, &r->header.delta_t) == 0;
+
+   for (int i = 0; i < REPLAY_USER && ok; i++)
+   {
+      ok = read_u32(r->file, &user) == 0;
+      r->header.user[i] = (Sint32)user;
+   }
+
+   if (!ok)
+   {
+      fclose(r->file);
+      r->file = NULL;
+      return -1;
+   }
+
+   r->mode = REPLAY_PLAY;
+   r->header.seed = seed;
+   r->delta_t = r->header.delta_t;
+
+   read_record(r);
+
+   return 0;
+}
+
+/*
+ * call once before every update. recording writes what changed in
+ * keypress and delta_t since the last tick, playback sets them to what
+ * was recorded. returns 0 when playback has no ticks left.
+ */
+int replay_step(struct replay *r, char *keypress, double *delta_t)
+{
+   if (r == NULL || r->file == NULL)
+      return -1;
+
+   if (r->mode == REPLAY_RECORD)
+   {
+      if (*delta_t != r->delta_t)
+      {
+         write_record(r, OP_DELTA_T);
+         write_double(r->file, *delta_t);
+         r->delta_t = *delta_t;
+      }
+
+      // most ticks change no keys
+      if (memcmp(keypress, r->keys, sizeof(r->keys)) != 0)
+      {
+         for (int i = 0; i < SDL_NUM_SCANCODES; i++)
+         {
+            if (!keypress[i] != !r->keys[i])
+            {
+               write_record(r, keypress[i] ? OP_KEY_DOWN : OP_KEY_UP);
+               fputc(i & 0xff, r->file);
+               fputc(i >> 8, r->file);
+            }
+
+            r->keys[i] = keypress[i];
+         }
+      }
+
+      r->tick++;
+      return 1;
+   }
+
+   while (r->op != OP_END && r->next == r->tick)
+   {
+      if (r->op == OP_DELTA_T)
+         r->delta_t = r->next_delta_t;
+      else
+         r->keys[r->key] = r->op == OP_KEY_DOWN;
+
+      read_record(r);
+   }
+
+   if (r->op == OP_END && r->tick >= r->next)
+      return 0;
+
+   memcpy(keypress, r->keys, sizeof(r->keys));
+   *delta_t = r->delta_t;
+   r->tick++;
+
+   return 1;
+}
+
+// recordings end with the number of ticks so playback stops in the same place
+int replay_close(struct replay *r)
+{
+   if (r == NULL || r->file == NULL)
+      return -1;
+
+   if (r->mode == REPLAY_RECORD)
+      write_record(r, OP_END);
+
+   int ret = fclose(r->file) == 0 ? 0 : -1;
+   r->file = NULL;
+
+   return ret;
+}
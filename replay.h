@@ -0,0 +1,63 @@
+/*
+ * Description:
+ * Records the seed, delta_t and key changes of every tick to a file
+ * and plays them back
+ */
+
+#ifndef REPLAY
+#define REPLAY
+
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+typedef struct replay replay;
+
+#define REPLAY_MAGIC        0x4c505241  // "ARPL"
+#define REPLAY_VERSION      2
+
+#define REPLAY_RECORD       1
+#define REPLAY_PLAY         2
+
+// values the game needs to start the same way, stored in the file
+#define REPLAY_USER         4
+
+struct replay_header
+{
+   Uint32 seed;
+   double delta_t;
+   Sint32 user[REPLAY_USER];
+};
+
+/*
+ * the file is the header and then one record per change. a record is
+ * the ticks since the last record as a varint, an op byte and its
+ * data: a two byte SDL_Scancode for key ops, a double for delta_t. all
+ * little endian.
+ */
+struct replay
+{
+   int mode;
+   FILE *file;
+   struct replay_header header;
+
+   // state the stream is at
+   char keys[SDL_NUM_SCANCODES];
+   double delta_t;
+
+   // ticks stepped, and the tick of the last record
+   unsigned long tick;
+   unsigned long last;
+
+   // playback: next record, read ahead
+   unsigned long next;
+   int op;
+   int key;
+   double next_delta_t;
+};
+
+int replay_record             (struct replay *r, const char *path, struct replay_header *header);
+int replay_play               (struct replay *r, const char *path);
+int replay_step               (struct replay *r, char *keypress, double *delta_t);
+int replay_close              (struct replay *r);
+
+#endif
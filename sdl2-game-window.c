@@ -1,12 +1,47 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include "sdl2-game-window.h"
+#include "framebuffer.h"
+#include "profiler.h"
+#include "replay.h"
+
+// most updates one frame can run before time gets dropped
+#define GAME_MAX_STEPS 5
 
 struct game_window game;
+static struct framebuffer game_framebuffer;
+
+// no keys held and nothing queued
+static void reset_input()
+{
+   memset(game.keypress, 0, sizeof(game.keypress));
+   memset(game.input_sent, 0, sizeof(game.input_sent));
+
+   SDL_AtomicSet(&game.input.head, 0);
+   SDL_AtomicSet(&game.input.tail, 0);
+
+   game.input_pending = 0;
+   game.frame_input = 0;
+
+   for (int i = 0; i < 3; i++)
+      game.snapshot_input[i] = 0;
+}
 
-int init_game_window(int width, int height, const char *title)
+/*
+ * render picks what the game draws with. GAME_RENDER_FRAMEBUFFER
+ * rasterizes on the cpu and uploads one texture per frame. pacing is
+ * one of GAME_PACE_*, vsync falls back to sleep when the renderer
+ * doesn't give it.
+ */
+int init_game_window(int width, int height, const char *title, int render, int pacing)
 {
    int wflags = 0; // window flags
-   int rflags = 0; // render flags
+   int rflags = SDL_RENDERER_ACCELERATED; // render flags
+
+   if (pacing == GAME_PACE_VSYNC)
+      rflags |= SDL_RENDERER_PRESENTVSYNC;
 
    if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
       return -1;
@@ -21,6 +56,10 @@ int init_game_window(int width, int height, const char *title)
 
    game.renderer = SDL_CreateRenderer(game.window, -1, rflags);
 
+   // no gpu, take whatever renderer there is
+   if (!game.renderer)
+      game.renderer = SDL_CreateRenderer(game.window, -1, rflags & ~SDL_RENDERER_ACCELERATED);
+
    if (!game.renderer)
    {
       SDL_DestroyWindow(game.window);
@@ -28,17 +67,59 @@ int init_game_window(int width, int height, const char *title)
       return -3;
    }
 
+   game.framebuffer = NULL;
+   game.texture = NULL;
+
+   if (render == GAME_RENDER_FRAMEBUFFER)
+   {
+      game.texture = SDL_CreateTexture(game.renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING, width, height);
+
+      if (!game.texture || framebuffer_init(&game_framebuffer, width, height, 0) != 0)
+      {
+         if (game.texture)
+            SDL_DestroyTexture(game.texture);
+         SDL_DestroyRenderer(game.renderer);
+         SDL_DestroyWindow(game.window);
+         SDL_Quit();
+         return -4;
+      }
+
+      game.framebuffer = &game_framebuffer;
+   }
+
    // init data
    game.width = width;
    game.height = height;
    game.running = 1;
    game.pause = 0;
+   game.headless = 0;
+   game.threaded = 0;
+   game.seed = SDL_GetTicks();
+
+   // a replay has to start from the seed it was recorded with
+   if (game.replay != NULL && game.replay->mode == REPLAY_PLAY)
+      game.seed = game.replay->header.seed;
+   game.tick = 0;
    game.delta_t = 0;
    game.max_fps = 60;
    game.fps = 0;
+   game.alpha = 1;
+
+   SDL_RendererInfo info;
+   game.pacing = pacing;
+
+   if (pacing == GAME_PACE_VSYNC && (SDL_GetRendererInfo(game.renderer, &info) != 0 ||
+         !(info.flags & SDL_RENDERER_PRESENTVSYNC)))
+      game.pacing = GAME_PACE_SLEEP;
+
+   // about the granularity of SDL_Delay to start with
+   game.frame_deadline = 0;
+   game.sleep_late = SDL_GetPerformanceFrequency() / 1000;
 
-   for (int i = 0; i < 128; i++)
-      game.keypress[i] = 0;
+   reset_input();
+
+   profiler_init(&profiler);
 
    SDL_RenderPresent(game.renderer);
    on_game_creation();
@@ -46,19 +127,157 @@ int init_game_window(int width, int height, const char *title)
    return 0;
 }
 
+// same as init_game_window but without a window or renderer
+int init_game_headless(int width, int height, unsigned int seed)
+{
+   if (SDL_Init(SDL_INIT_TIMER) != 0)
+      return -1;
+
+   game.window = NULL;
+   game.renderer = NULL;
+   game.framebuffer = NULL;
+   game.texture = NULL;
+
+   // init data
+   game.width = width;
+   game.height = height;
+   game.running = 1;
+   game.pause = 0;
+   game.headless = 1;
+   game.threaded = 0;
+   game.seed = seed;
+   game.tick = 0;
+   game.delta_t = 0;
+   game.max_fps = 0;
+   game.pacing = GAME_PACE_UNCAPPED;
+   game.fps = 0;
+   game.alpha = 1;
+
+   reset_input();
+
+   profiler_init(&profiler);
+
+   on_game_creation();
+
+   return 0;
+}
+
 void close_game_window()
 {
    // clean up
-   SDL_DestroyWindow(game.window);
-   SDL_DestroyRenderer(game.renderer);
+   if (game.framebuffer != NULL)
+      framebuffer_free(game.framebuffer);
+   if (game.texture != NULL)
+      SDL_DestroyTexture(game.texture);
+   if (game.renderer != NULL)
+      SDL_DestroyRenderer(game.renderer);
+   if (game.window != NULL)
+      SDL_DestroyWindow(game.window);
    SDL_Quit();
 
    game.window = NULL;
    game.renderer = NULL;
+   game.framebuffer = NULL;
+   game.texture = NULL;
+}
+
+void clear_game_frame()
+{
+   if (game.framebuffer != NULL)
+      framebuffer_clear(game.framebuffer, 0xff000000);
+   else
+      SDL_RenderClear(game.renderer);
+}
+
+// the framebuffer goes out as one texture upload
+void present_game_frame()
+{
+   if (game.framebuffer != NULL)
+   {
+      profile_begin(PROFILE_RENDER);
+      framebuffer_render(game.framebuffer);
+      profile_end(PROFILE_RENDER);
+
+      profile_begin(PROFILE_PRESENT);
+      framebuffer_present(game.framebuffer, game.renderer, game.texture);
+      profile_end(PROFILE_PRESENT);
+   }
+
+   profile_begin(PROFILE_PRESENT);
+   SDL_RenderPresent(game.renderer);
+   profile_end(PROFILE_PRESENT);
+
+   // input to photon, from the oldest key change this frame shows
+   if (game.frame_input != 0)
+   {
+      Uint64 now = SDL_GetPerformanceCounter();
+
+      profiler_input(&profiler, (float)((double)(now - game.frame_input) * 1000.0 / SDL_GetPerformanceFrequency()));
+      game.frame_input = 0;
+   }
+}
+
+// queue a key change for the steps, -1 if the ring is full
+static int push_input(int key, char down, Uint64 time)
+{
+   int head = SDL_AtomicGet(&game.input.head);
+
+   if (head - SDL_AtomicGet(&game.input.tail) >= INPUT_RING_SIZE)
+      return -1;
+
+   struct input_event *e = &game.input.events[head & (INPUT_RING_SIZE - 1)];
+   e->key = key;
+   e->down = down;
+   e->time = time;
+
+   // publish the event after it's written
+   SDL_AtomicSet(&game.input.head, head + 1);
+
+   game.input_sent[key] = down;
+
+   return 0;
+}
+
+/*
+ * apply the key changes from up to time. the rest wait for a later
+ * step, so several steps run in one go each see the keys of their own
+ * moment.
+ */
+static void drain_input(Uint64 time)
+{
+   int tail = SDL_AtomicGet(&game.input.tail);
+   int head = SDL_AtomicGet(&game.input.head);
+
+   for (; tail != head; tail++)
+   {
+      struct input_event *e = &game.input.events[tail & (INPUT_RING_SIZE - 1)];
+
+      if (e->time > time)
+         break;
+
+      game.keypress[e->key] = e->down;
+
+      if (game.input_pending == 0 || e->time < game.input_pending)
+         game.input_pending = e->time;
+   }
+
+   SDL_AtomicSet(&game.input.tail, tail);
+}
+
+// event timestamps are SDL_GetTicks milliseconds, move them onto the performance counter
+static Uint64 event_time(Uint32 timestamp)
+{
+   Uint64 now = SDL_GetPerformanceCounter();
+   Uint64 age = (Uint64)(SDL_GetTicks() - timestamp) * SDL_GetPerformanceFrequency() / 1000;
+
+   return age < now ? now - age : now;
 }
 
 void handle_events()
 {
+   // a replay owns keypress while it plays
+   int playing = game.replay != NULL && game.replay->mode == REPLAY_PLAY;
+
    while (SDL_PollEvent(&(game.event)))
    {
       switch (game.event.type)
@@ -68,36 +287,371 @@ void handle_events()
             break;
 
          case SDL_KEYDOWN:
-            if (game.event.key.keysym.sym < 128)
-               game.keypress[game.event.key.keysym.sym] = 1;
-            break;
-
          case SDL_KEYUP:
-            if (game.event.key.keysym.sym < 128)
-               game.keypress[game.event.key.keysym.sym] = 0;
+         {
+            int key = game.event.key.keysym.scancode;
+            char down = game.event.type == SDL_KEYDOWN;
+
+            if (playing || game.event.key.repeat || key < 0 || key >= SDL_NUM_SCANCODES)
+               break;
+
+            push_input(key, down, event_time(game.event.key.timestamp));
             break;
+         }
       };
    }
+
+   if (playing)
+      return;
+
+   // the keyboard state is the truth, catch changes the ring missed when it was full
+   const Uint8 *state = SDL_GetKeyboardState(NULL);
+
+   if (memcmp(state, game.input_sent, SDL_NUM_SCANCODES) != 0)
+   {
+      Uint64 now = SDL_GetPerformanceCounter();
+
+      for (int i = 0; i < SDL_NUM_SCANCODES; i++)
+         if (state[i] != game.input_sent[i] && push_input(i, state[i], now) != 0)
+            break;
+   }
+}
+
+/*
+ * one on_game_update standing for the moment time. a replay records the
+ * input of the step or sets it, and ends the game when playback runs out.
+ */
+static void game_step(Uint64 time)
+{
+   drain_input(time);
+
+   if (game.replay != NULL && replay_step(game.replay, game.keypress, &game.delta_t) == 0)
+   {
+      game.running = 0;
+      return;
+   }
+
+   on_game_update();
+   game.tick++;
+}
+
+/*
+ * SDL_Delay only sleeps whole milliseconds and wakes up late, so sleep
+ * until about sleep_late before end and spin the rest. sleep_late
+ * follows how late sleeps have been, jumping up at once and easing
+ * back down.
+ */
+static void sleep_until(Uint64 end)
+{
+   Uint64 frequency = SDL_GetPerformanceFrequency();
+   Uint64 now = SDL_GetPerformanceCounter();
+
+   if (now + game.sleep_late < end)
+   {
+      Uint32 ms = (Uint32)((end - now - game.sleep_late) * 1000 / frequency);
+
+      if (ms > 0)
+      {
+         Uint64 wake = now + (Uint64)ms * frequency / 1000;
+
+         SDL_Delay(ms);
+         now = SDL_GetPerformanceCounter();
+
+         Uint64 late = now > wake ? now - wake : 0;
+
+         if (late > game.sleep_late)
+            game.sleep_late = late;
+         else
+            game.sleep_late -= (game.sleep_late - late) / 8;
+      }
+   }
+
+   while (now < end)
+      now = SDL_GetPerformanceCounter();
+}
+
+/*
+ * pace frames to max_fps when pacing by sleep. frames end on a fixed
+ * schedule so time spent outside the wait doesn't add up, a frame that
+ * overran starts the schedule over instead of rushing the next ones.
+ */
+static void wait_frame()
+{
+   if (game.pacing != GAME_PACE_SLEEP || game.max_fps <= 0)
+      return;
+
+   Uint64 now = SDL_GetPerformanceCounter();
+
+   game.frame_deadline += (Uint64)(SDL_GetPerformanceFrequency() / game.max_fps);
+
+   if (game.frame_deadline <= now)
+   {
+      game.frame_deadline = now;
+      return;
+   }
+
+   sleep_until(game.frame_deadline);
 }
 
-int start_game()
+/*
+ * fixed timestep loop. real time goes into an accumulator and
+ * on_game_update runs once per delta_t of it, at most GAME_MAX_STEPS
+ * times a frame so a slow update can't snowball. on_game_render then
+ * draws alpha of the way between the last two steps.
+ */
+int start_game(double delta_t)
 {
-   unsigned int start, end;
+   if (game.headless || delta_t <= 0)
+      return -1;
+
+   game.delta_t = delta_t;
+
+   Uint64 frequency = SDL_GetPerformanceFrequency();
+   Uint64 last = SDL_GetPerformanceCounter();
+   double accumulator = 0;
+
+   game.frame_deadline = last;
+
    while (game.running)
    {
-      start = SDL_GetTicks();
+      // events first so the steps below can reach every key change
+      profile_begin(PROFILE_EVENTS);
+      handle_events();
+      profile_end(PROFILE_EVENTS);
+
+      Uint64 start = SDL_GetPerformanceCounter();
+      double frame = (double)(start - last) / frequency;
 
+      game.fps = frame > 0 ? 1 / frame : 0;
+      last = start;
+      accumulator += frame;
+
+      // each step stands for the moment its delta_t ends
+      int steps = 0;
+      while (accumulator >= delta_t && steps < GAME_MAX_STEPS && game.running)
+      {
+         game_step(start - (Uint64)((accumulator - delta_t) * frequency));
+         accumulator -= delta_t;
+         steps++;
+      }
+
+      // too far behind, drop the missed steps but keep the phase
+      if (accumulator >= delta_t)
+         accumulator = fmod(accumulator, delta_t);
+
+      // this frame shows what the steps applied
+      game.frame_input = game.input_pending;
+      game.input_pending = 0;
+
+      game.alpha = accumulator / delta_t;
+      on_game_render();
+      profiler_frame(&profiler);
+
+      wait_frame();
+   }
+
+   return 0;
+}
+
+/*
+ * runs a fixed number of ticks with a fixed delta_t as fast as possible.
+ * input comes from whatever on_game_update sets in keypress.
+ */
+int start_game_headless(unsigned long ticks, double delta_t)
+{
+   if (!game.headless)
+      return -1;
+
+   game.delta_t = delta_t;
+   game.fps = 1 / delta_t;
+
+   Uint64 start = SDL_GetPerformanceCounter();
+
+   while (game.running && game.tick < ticks)
+   {
+      game_step(0);
+      profiler_frame(&profiler);
+   }
+
+   Uint64 end = SDL_GetPerformanceCounter();
+
+   double seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+   printf("headless: %lu ticks in %.3f s (%.0f ticks/s)\n",
+         game.tick, seconds, seconds > 0 ? game.tick / seconds : 0);
+
+   return 0;
+}
+
+// set in snapshot_ready when the sim thread has handed over a new snapshot
+#define SNAPSHOT_FRESH 4
+
+/*
+ * steps on_game_update at a fixed rate. when it falls more than
+ * GAME_MAX_STEPS behind it drops the missed steps instead of trying to
+ * catch up.
+ */
+static int game_sim_thread(void *data)
+{
+   (void)data;
+
+   Uint64 frequency = SDL_GetPerformanceFrequency();
+   Uint64 step = game.delta_t * frequency;
+   Uint64 next = SDL_GetPerformanceCounter();
+
+   while (SDL_AtomicGet(&game.sim_running))
+   {
+      game_step(next);
+
+      next += step;
+      Uint64 now = SDL_GetPerformanceCounter();
+
+      if (now > next + step * GAME_MAX_STEPS)
+         next = now;
+
+      while (now < next && SDL_AtomicGet(&game.sim_running))
+      {
+         SDL_Delay((next - now) * 1000 / frequency);
+         now = SDL_GetPerformanceCounter();
+      }
+   }
+
+   return 0;
+}
+
+/*
+ * runs on_game_update on its own thread every delta_t seconds while
+ * this thread handles events and calls on_game_render as fast as
+ * game.pacing allows. keys reach the sim thread through game.input and
+ * finished frames come back through the snapshot functions below.
+ */
+int start_game_threaded(double delta_t)
+{
+   if (game.headless || delta_t <= 0)
+      return -1;
+
+   game.threaded = 1;
+   game.delta_t = delta_t;
+
+   game.snapshot_front = 0;
+   game.snapshot_back = 1;
+   SDL_AtomicSet(&game.snapshot_ready, 2);
+
+   for (int i = 0; i < 3; i++)
+      game.snapshot_time[i] = SDL_GetPerformanceCounter();
+
+   SDL_AtomicSet(&game.sim_running, 1);
+   SDL_Thread *sim = SDL_CreateThread(game_sim_thread, "sim", NULL);
+
+   if (sim == NULL)
+   {
+      game.threaded = 0;
+      return -1;
+   }
+
+   Uint64 frequency = SDL_GetPerformanceFrequency();
+   Uint64 last = SDL_GetPerformanceCounter();
+
+   game.frame_deadline = last;
+
+   while (game.running)
+   {
+      Uint64 start = SDL_GetPerformanceCounter();
+
+      game.fps = start > last ? (double)frequency / (double)(start - last) : 0;
+      last = start;
+
+      profile_begin(PROFILE_EVENTS);
+      handle_events();
+      profile_end(PROFILE_EVENTS);
+
+      // draw between the newest snapshot and the step before it
+      int front = acquire_game_snapshot();
+      game.alpha = (double)(start - game.snapshot_time[front]) / frequency / delta_t;
+      game.alpha = game.alpha > 1 ? 1 : game.alpha < 0 ? 0 : game.alpha;
+
+      on_game_render();
+      profiler_frame(&profiler);
+
+      wait_frame();
+   }
+
+   SDL_AtomicSet(&game.sim_running, 0);
+   SDL_WaitThread(sim, NULL);
+
+   game.threaded = 0;
+
+   return 0;
+}
+
+/*
+ * plays game.replay back as fast as possible, drawing every step.
+ * headless playback goes through start_game_headless instead.
+ */
+int start_game_replay()
+{
+   if (game.headless || game.replay == NULL || game.replay->mode != REPLAY_PLAY)
+      return -1;
+
+   game.delta_t = game.replay->delta_t;
+   game.alpha = 1;
+
+   Uint64 frequency = SDL_GetPerformanceFrequency();
+   Uint64 start = SDL_GetPerformanceCounter();
+   Uint64 last = start;
+
+   while (game.running)
+   {
+      Uint64 now = SDL_GetPerformanceCounter();
+
+      game.fps = now > last ? (double)frequency / (double)(now - last) : 0;
+      last = now;
+
+      profile_begin(PROFILE_EVENTS);
       handle_events();
-      on_game_update();
+      profile_end(PROFILE_EVENTS);
 
-      if (game.max_fps > 0)
-         SDL_Delay((1000.0f / game.max_fps) - (SDL_GetTicks() - start));
+      game_step(0);
 
-      end = SDL_GetTicks();
+      if (!game.running)
+         break;
 
-      game.delta_t = (float)(end - start) / 1000.0f;
-      game.fps = 1 / game.delta_t;
+      on_game_render();
+      profiler_frame(&profiler);
    }
 
+   double seconds = (double)(SDL_GetPerformanceCounter() - start) / frequency;
+   printf("replay: %lu ticks in %.3f s (%.0f ticks/s)\n",
+         game.tick, seconds, seconds > 0 ? game.tick / seconds : 0);
+
    return 0;
 }
+
+/*
+ * sim thread: hand over the filled back snapshot and get the next one
+ * to fill. input in a snapshot that was never drawn is counted with
+ * the next one.
+ */
+int publish_game_snapshot()
+{
+   game.snapshot_time[game.snapshot_back] = SDL_GetPerformanceCounter();
+   game.snapshot_input[game.snapshot_back] = game.input_pending;
+
+   int ready = SDL_AtomicSet(&game.snapshot_ready, game.snapshot_back | SNAPSHOT_FRESH);
+
+   game.snapshot_back = ready & 3;
+   game.input_pending = ready & SNAPSHOT_FRESH ? game.snapshot_input[game.snapshot_back] : 0;
+
+   return game.snapshot_back;
+}
+
+// render thread: index of the newest snapshot handed over
+int acquire_game_snapshot()
+{
+   if (SDL_AtomicGet(&game.snapshot_ready) & SNAPSHOT_FRESH)
+   {
+      game.snapshot_front = SDL_AtomicSet(&game.snapshot_ready, game.snapshot_front) & 3;
+      game.frame_input = game.snapshot_input[game.snapshot_front];
+   }
+
+   return game.snapshot_front;
+}
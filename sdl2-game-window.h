@@ -2,6 +2,45 @@
 #define GAME_WINDOW
 
 typedef struct game_window game_window;
+typedef struct input_ring input_ring;
+
+// renderers for init_game_window
+#define GAME_RENDER_SDL             0
+#define GAME_RENDER_FRAMEBUFFER     1
+
+/*
+ * frame pacing for init_game_window. sleep sleeps most of the way to
+ * 1 / max_fps and spins the rest, vsync waits in present for the
+ * display and uncapped draws as fast as it can.
+ */
+#define GAME_PACE_SLEEP             0
+#define GAME_PACE_VSYNC             1
+#define GAME_PACE_UNCAPPED          2
+
+// key changes from the event thread to the sim thread, size is a power of two
+#define INPUT_RING_SIZE             256
+
+struct input_event
+{
+   // SDL_Scancode
+   int key;
+   char down;
+
+   // performance counter when the key changed
+   Uint64 time;
+};
+
+/*
+ * single producer single consumer queue. only the event thread moves
+ * head and only the step that drains it moves tail. events are in time
+ * order, each step takes the ones from before the time it stands for.
+ */
+struct input_ring
+{
+   struct input_event events[INPUT_RING_SIZE];
+   SDL_atomic_t head;
+   SDL_atomic_t tail;
+};
 
 struct game_window
 {
@@ -10,29 +49,86 @@ struct game_window
    SDL_Renderer *renderer;
    SDL_Event event;
 
+   // software renderer, NULL when drawing through SDL_Renderer
+   struct framebuffer *framebuffer;
+   SDL_Texture *texture;
+
    // settings
    int width;
    int height;
 
-   // frame info
+   // frame info, delta_t is the fixed step of the simulation
    double delta_t;
    double fps;
    float max_fps;
 
+   // GAME_PACE_*, sleep when vsync was asked for but the renderer can't
+   int pacing;
+
+   /*
+    * end of the current frame when pacing by sleep, and how late a
+    * sleep usually wakes up. the last sleep_late of a frame is spun.
+    */
+   Uint64 frame_deadline;
+   Uint64 sleep_late;
+
+   // how far rendering is between the last two steps, 0 to 1
+   double alpha;
+
    // bools
    char running;
    char pause;
+   char headless;
+   char threaded;
+
+   // simulation info
+   unsigned int seed;
+   unsigned long tick;
+
+   // keys held by SDL_Scancode, only steps change it
+   char keypress[SDL_NUM_SCANCODES];
+
+   // key changes waiting for their step, and the keys the event thread has queued
+   struct input_ring input;
+   Uint8 input_sent[SDL_NUM_SCANCODES];
+
+   // threaded mode, see start_game_threaded
+   SDL_atomic_t sim_running;
+
+   // triple buffered snapshots 0 to 2, back belongs to the sim thread and front to the render thread
+   int snapshot_back;
+   int snapshot_front;
+   SDL_atomic_t snapshot_ready;
+   Uint64 snapshot_time[3];
+
+   /*
+    * input to photon latency. steps keep the time of the oldest key
+    * change they applied in input_pending until a frame shows it, the
+    * frame keeps it in frame_input until it is presented. 0 is none.
+    */
+   Uint64 input_pending;
+   Uint64 snapshot_input[3];
+   Uint64 frame_input;
 
-   // key handle
-   char keypress[128];
+   // input is recorded into or played back from this when not NULL, see replay.h
+   struct replay *replay;
 };
 
 extern struct game_window game;
 
-int init_game_window       (int width, int height, const char *title);
+int init_game_window       (int width, int height, const char *title, int render, int pacing);
+int init_game_headless     (int width, int height, unsigned int seed);
 void close_game_window     ();
-int start_game             ();
+void clear_game_frame      ();
+void present_game_frame    ();
+int start_game             (double delta_t);
+int start_game_headless    (unsigned long ticks, double delta_t);
+int start_game_threaded    (double delta_t);
+int start_game_replay      ();
+int publish_game_snapshot  ();
+int acquire_game_snapshot  ();
 int on_game_update         ();
+int on_game_render         ();
 int on_game_creation       ();
 
 #endif
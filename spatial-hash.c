@@ -0,0 +1,247 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spatial-hash.h"
+
+int spatial_hash_init(struct spatial_hash *h, float width, float height, float cell_size)
+{
+   if (h == NULL)
+      return -1;
+
+   if (width <= 0 || height <= 0 || cell_size <= 0)
+      return -1;
+
+   h->width = width;
+   h->height = height;
+   h->cell_size = cell_size;
+   h->cols = (int)ceil(width / cell_size);
+   h->rows = (int)ceil(height / cell_size);
+
+   h->cells = (int *)malloc(sizeof(int) * h->cols * h->rows);
+
+   if (h->cells == NULL)
+      return -1;
+
+   h->entries = NULL;
+   h->nentries = 0;
+   h->max_entries = 0;
+
+   h->stamps = NULL;
+   h->max_ids = 0;
+   h->query = 0;
+
+   spatial_hash_clear(h);
+
+   return 0;
+}
+
+void spatial_hash_clear(struct spatial_hash *h)
+{
+   for (int i = 0; i < h->cols * h->rows; i++)
+      h->cells[i] = -1;
+
+   h->nentries = 0;
+}
+
+// wrap a cell coordinate the same way positions wrap around the screen
+static int wrap_cell(int c, int n)
+{
+   c %= n;
+   return c < 0 ? c + n : c;
+}
+
+/*
+ * get the range of cells a box touches. the range is not wrapped
+ * yet but is clamped so no cell gets visited twice.
+ */
+static void box_range(const struct spatial_hash *h, float min_x, float min_y, float max_x, float max_y, int *x0, int *y0, int *x1, int *y1)
+{
+   *x0 = (int)floor(min_x / h->cell_size);
+   *y0 = (int)floor(min_y / h->cell_size);
+   *x1 = (int)floor(max_x / h->cell_size);
+   *y1 = (int)floor(max_y / h->cell_size);
+
+   if (*x1 - *x0 >= h->cols)
+      *x1 = *x0 + h->cols - 1;
+
+   if (*y1 - *y0 >= h->rows)
+      *y1 = *y0 + h->rows - 1;
+}
+
+// get the range of cells a circle touches
+static void cell_range(const struct spatial_hash *h, float x, float y, float radius, int *x0, int *y0, int *x1, int *y1)
+{
+   box_range(h, x - radius, y - radius, x + radius, y + radius, x0, y0, x1, y1);
+}
+
+int spatial_hash_insert(struct spatial_hash *h, int id, float x, float y, float radius)
+{
+   if (h == NULL || id < 0)
+      return -1;
+
+   // make room for stamps
+   if (id >= h->max_ids)
+   {
+      int max_ids = h->max_ids ? h->max_ids : 64;
+      while (max_ids <= id)
+         max_ids *= 2;
+
+      unsigned int *stamps = (unsigned int *)realloc(h->stamps, sizeof(unsigned int) * max_ids);
+      if (stamps == NULL)
+         return -1;
+
+      memset(stamps + h->max_ids, 0, sizeof(unsigned int) * (max_ids - h->max_ids));
+      h->stamps = stamps;
+      h->max_ids = max_ids;
+   }
+
+   int x0, y0, x1, y1;
+   cell_range(h, x, y, radius, &x0, &y0, &x1, &y1);
+
+   // make room for entries
+   int needed = h->nentries + (x1 - x0 + 1) * (y1 - y0 + 1);
+   if (needed > h->max_entries)
+   {
+      int max_entries = h->max_entries ? h->max_entries : 256;
+      while (max_entries < needed)
+         max_entries *= 2;
+
+      void *entries = realloc(h->entries, sizeof(*h->entries) * max_entries);
+      if (entries == NULL)
+         return -1;
+
+      h->entries = entries;
+      h->max_entries = max_entries;
+   }
+
+   // objects past the edge of the screen also go in the cells on the other side
+   for (int cy = y0; cy <= y1; cy++)
+   {
+      int row = wrap_cell(cy, h->rows) * h->cols;
+
+      for (int cx = x0; cx <= x1; cx++)
+      {
+         int cell = row + wrap_cell(cx, h->cols);
+
+         h->entries[h->nentries].id = id;
+         h->entries[h->nentries].next = h->cells[cell];
+         h->cells[cell] = h->nentries++;
+      }
+   }
+
+   return 0;
+}
+
+static int idcmp(const void *a, const void *b)
+{
+   return *(const int *)a - *(const int *)b;
+}
+
+// sort ids and drop repeats, returns how many are left
+static int sort_unique(int *ids, int n)
+{
+   qsort(ids, n, sizeof(int), idcmp);
+
+   int unique = 0;
+   for (int i = 0; i < n; i++)
+      if (unique == 0 || ids[unique - 1] != ids[i])
+         ids[unique++] = ids[i];
+
+   return unique;
+}
+
+/*
+ * get ids of everything inserted into cells touched by the circle.
+ * each id is returned once and ids are sorted from lowest to highest
+ * so results come out in the same order as a linear scan. returns the
+ * number of ids written to out.
+ */
+int spatial_hash_query(struct spatial_hash *h, float x, float y, float radius, int *out, int max_out)
+{
+   if (h == NULL || out == NULL)
+      return 0;
+
+   // reset stamps when the counter wraps
+   if (++h->query == 0)
+   {
+      memset(h->stamps, 0, sizeof(unsigned int) * h->max_ids);
+      h->query = 1;
+   }
+
+   int x0, y0, x1, y1;
+   cell_range(h, x, y, radius, &x0, &y0, &x1, &y1);
+
+   int n = 0;
+   for (int cy = y0; cy <= y1; cy++)
+   {
+      int row = wrap_cell(cy, h->rows) * h->cols;
+
+      for (int cx = x0; cx <= x1; cx++)
+      {
+         for (int e = h->cells[row + wrap_cell(cx, h->cols)]; e != -1; e = h->entries[e].next)
+         {
+            int id = h->entries[e].id;
+
+            if (h->stamps[id] == h->query || n == max_out)
+               continue;
+
+            h->stamps[id] = h->query;
+            out[n++] = id;
+         }
+      }
+   }
+
+   qsort(out, n, sizeof(int), idcmp);
+
+   return n;
+}
+
+/*
+ * get ids of everything in cells touched by the box around a segment,
+ * grown by radius. sorted and each id once like spatial_hash_query,
+ * but it only reads the grid so any number of threads can call it at
+ * once.
+ */
+int spatial_hash_query_segment(const struct spatial_hash *h, float x0, float y0, float x1, float y1, float radius, int *out, int max_out)
+{
+   if (h == NULL || out == NULL)
+      return 0;
+
+   int cx0, cy0, cx1, cy1;
+   box_range(h, (x0 < x1 ? x0 : x1) - radius, (y0 < y1 ? y0 : y1) - radius,
+         (x0 > x1 ? x0 : x1) + radius, (y0 > y1 ? y0 : y1) + radius, &cx0, &cy0, &cx1, &cy1);
+
+   int n = 0;
+   for (int cy = cy0; cy <= cy1; cy++)
+   {
+      int row = wrap_cell(cy, h->rows) * h->cols;
+
+      for (int cx = cx0; cx <= cx1; cx++)
+      {
+         for (int e = h->cells[row + wrap_cell(cx, h->cols)]; e != -1; e = h->entries[e].next)
+         {
+            // ids repeat in every cell they touch, drop them once out fills up
+            if (n == max_out && (n = sort_unique(out, n)) == max_out)
+               return n;
+
+            out[n++] = h->entries[e].id;
+         }
+      }
+   }
+
+   return sort_unique(out, n);
+}
+
+void spatial_hash_free(struct spatial_hash *h)
+{
+   if (h == NULL)
+      return;
+
+   free(h->cells);
+   free(h->entries);
+   free(h->stamps);
+
+   h->cells = NULL;
+   h->entries = NULL;
+   h->stamps = NULL;
+}
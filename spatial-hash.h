@@ -0,0 +1,38 @@
+/*
+ * Description:
+ * Uniform grid over a wrapping playfield used to find collision candidates
+ */
+
+#ifndef SPATIAL_HASH
+#define SPATIAL_HASH
+
+typedef struct spatial_hash spatial_hash;
+
+struct spatial_hash
+{
+   float width, height;
+   float cell_size;
+   int cols, rows;
+
+   // first entry in each cell or -1 when empty
+   int *cells;
+
+   // each cell is a linked list of entries
+   struct { int id, next; } *entries;
+   int nentries;
+   int max_entries;
+
+   // last query each id was returned by so duplicates get skipped
+   unsigned int *stamps;
+   int max_ids;
+   unsigned int query;
+};
+
+int spatial_hash_init         (struct spatial_hash *h, float width, float height, float cell_size);
+void spatial_hash_clear       (struct spatial_hash *h);
+int spatial_hash_insert       (struct spatial_hash *h, int id, float x, float y, float radius);
+int spatial_hash_query        (struct spatial_hash *h, float x, float y, float radius, int *out, int max_out);
+int spatial_hash_query_segment(const struct spatial_hash *h, float x0, float y0, float x1, float y1, float radius, int *out, int max_out);
+void spatial_hash_free        (struct spatial_hash *h);
+
+#endif
@@ -0,0 +1,799 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "world.h"
+#include "collision.h"
+#include "profiler.h"
+#include "fast-math.h"
+
+#define PI              3.1415926535897932384626433832795
+
+int wrap_position(float x, float y, float *ox, float *oy)
+{
+   if (x < 0)
+   {
+      if (ox != NULL)
+         *ox = SCREEN_WIDTH;
+      return 1;
+   }
+
+   if (y < 0)
+   {
+      if (oy != NULL)
+         *oy = SCREEN_HEIGHT;
+      return 1;
+   }
+
+   if (x > SCREEN_WIDTH)
+   {
+      if (ox != NULL)
+         *ox = 0;
+      return 1;
+   }
+
+   if (y > SCREEN_HEIGHT)
+   {
+      if (oy != NULL)
+         *oy = 0;
+      return 1;
+   }
+
+   return 0;
+}
+
+struct pose get_pose(struct polygon *p)
+{
+   struct pose pose = { p->x, p->y, p->angle };
+   return pose;
+}
+
+static int nworkers(struct world *w)
+{
+   return w->jobs != NULL ? w->jobs->nworkers : 1;
+}
+
+// the profiler only follows one world
+static void begin_phase(struct world *w, enum profile_phase phase)
+{
+   if (w->profile)
+      profile_begin(phase);
+}
+
+static void end_phase(struct world *w, enum profile_phase phase)
+{
+   if (w->profile)
+      profile_end(phase);
+}
+
+/*
+ * make the shapes once, spawning then only copies one of them instead
+ * of building a new outline and hull every time
+ */
+static int init_outlines(struct world *w)
+{
+   float vectors[ASTROID_SIDES * 2];
+
+   for (int i = 0; i < ASTROID_SHAPES; i++)
+   {
+      rand_polygon_vectors_seeded(vectors, ASTROID_SIDES, ASTROIDS_SIZE, ASTROIDS_SIZE * 0.7f, 1, &w->rng);
+
+      if (object_pool_add_outline(&w->astroids, vectors) < 0)
+         return -1;
+   }
+
+   reg_polygon_vectors(vectors, BULLET_SIDES, BULLET_SIZE);
+   w->bullet_outline = object_pool_add_outline(&w->bullets, vectors);
+
+   return w->bullet_outline < 0 ? -1 : 0;
+}
+
+static int grid_astroid(struct world *w, int i)
+{
+   return spatial_hash_insert(&w->astroid_grid, i, w->astroids.x[i], w->astroids.y[i],
+         polygon_bounding_radius(&w->astroids.shape[i]));
+}
+
+// add one astroid with a random shape, direction and speed
+static int spawn_astroid(struct world *w, float x, float y, float scale)
+{
+   int outline = rand_seeded(&w->rng) % w->astroids.noutlines;
+   float angle = (float)((double)rand_seeded(&w->rng) * (double)((2 * PI) / RAND_MAX));
+
+   float s, c;
+   fast_sincosf(angle, &s, &c);
+
+   float vx = c * (rand_seeded(&w->rng) % (int)(ASTROIDS_SPEED / scale));
+   float vy = s * (rand_seeded(&w->rng) % (int)(ASTROIDS_SPEED / scale));
+
+   int i = object_pool_add(&w->astroids, outline, x, y, angle, scale, vx, vy);
+
+   if (i < 0)
+      return -1;
+
+   // an astroid missing from the grid could never be hit, i is the last so nothing moves
+   if (grid_astroid(w, i) != 0)
+   {
+      object_pool_remove(&w->astroids, i);
+      return -1;
+   }
+
+   return 0;
+}
+
+static int add_astroid(struct world *w, float x, float y, float scale, int nadd)
+{
+   if (scale <= 0)
+      return -1;
+
+   for (int i = 0; i < nadd; i++)
+   {
+      // if full
+      if (spawn_astroid(w, x, y, scale) != 0)
+         return -1;
+   }
+
+   return 0;
+}
+
+static int add_astroid_rpos(struct world *w, float scale, int nadd)
+{
+   if (scale <= 0)
+      return -1;
+
+   struct polygon *ship = w->player.ship;
+
+   for (int i = 0; i < nadd; i++)
+   {
+      float x = rand_seeded(&w->rng) % SCREEN_WIDTH;
+      float y = rand_seeded(&w->rng) % SCREEN_HEIGHT;
+
+      float angle;
+
+      // get x distance from player, y distance from player, and max diameter of an astroid.
+      float a = x - ship->x;
+      float b = y - ship->y;
+      float c = ASTROIDS_SIZE * ASTROIDS_SCALE * 2.0f;
+
+      // check if astroid position is too close to player.
+      if (a * a + b * b < c * c)
+      {
+         float sn, cs;
+
+         angle = 1.0f / tanf(b / a);
+         fast_sincosf(angle, &sn, &cs);
+         x = cs * ((float)ASTROIDS_SIZE * (float)ASTROIDS_SCALE * 2.0f) + ship->x;
+         y = sn * ((float)ASTROIDS_SIZE * (float)ASTROIDS_SCALE * 2.0f) + ship->y;
+         wrap_position(x, y, &x, &y);
+      }
+
+      // if full
+      if (spawn_astroid(w, x, y, scale) != 0)
+         return -1;
+   }
+
+   return 0;
+}
+
+/*
+ * the last astroid gets moved into index so it is added to the grid
+ * again under its new index. if the grid has no room for it it gets
+ * removed as well, like an astroid that failed to spawn.
+ */
+static int remove_astroid(struct world *w, int index)
+{
+   int moved = object_pool_remove(&w->astroids, index);
+
+   if (moved < 0)
+      return -1;
+
+   while (moved && grid_astroid(w, index) != 0)
+      moved = object_pool_remove(&w->astroids, index);
+
+   return 0;
+}
+
+// ids in the grid are always below the pool capacity
+static int reserve_candidates(struct world *w)
+{
+   if (w->max_candidates < w->astroids.capacity)
+   {
+      int *p = (int *)realloc(w->candidates, sizeof(int) * w->astroids.capacity);
+
+      if (p == NULL)
+         return -1;
+
+      w->candidates = p;
+      w->max_candidates = w->astroids.capacity;
+   }
+
+   return 0;
+}
+
+// find astroids that could touch a circle, returns number of candidates
+static int query_astroids(struct world *w, float x, float y, float radius)
+{
+   if (reserve_candidates(w) != 0)
+      return 0;
+
+   return spatial_hash_query(&w->astroid_grid, x, y, radius, w->candidates, w->max_candidates);
+}
+
+// how far an astroid can move in a step, bullet paths are padded by it
+static float astroid_step(struct world *w)
+{
+   return ASTROIDS_SPEED * w->delta_t;
+}
+
+// find astroids bullet i could have hit since the last step
+static int query_bullet_path(struct world *w, int i)
+{
+   if (reserve_candidates(w) != 0)
+      return 0;
+
+   return spatial_hash_query_segment(&w->astroid_grid, w->bullets.last_x[i], w->bullets.last_y[i],
+         w->bullets.x[i], w->bullets.y[i], astroid_step(w), w->candidates, w->max_candidates);
+}
+
+static int add_bullet(struct world *w)
+{
+   struct polygon *ship = w->player.ship;
+
+   float s, c;
+   fast_sincosf(ship->angle, &s, &c);
+
+   float vx = c * (float)BULLET_SPEED;
+   float vy = s * (float)BULLET_SPEED;
+
+   // is full
+   // bullets come out of the ship's nose
+   float *nose = polygon_vertices(ship);
+
+   if (object_pool_add(&w->bullets, w->bullet_outline, nose[0], nose[1], ship->angle, 1, vx, vy) < 0)
+      return -1;
+
+   return 0;
+}
+
+static int remove_bullet(struct world *w, int index)
+{
+   if (object_pool_remove(&w->bullets, index) < 0)
+      return -1;
+
+   return 0;
+}
+
+// returns -1 if not every astroid of the first round could be added
+int world_restart(struct world *w)
+{
+   // reset player status
+   polygon_translate(w->player.ship, SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f);
+   w->player.last_ship = get_pose(w->player.ship);
+   w->player.velocity.x = 0;
+   w->player.velocity.y = 0;
+
+   w->bullet_timer = 0;
+   w->current_round = 1;
+
+   // free bullets and astroids
+   object_pool_clear(&w->bullets);
+   object_pool_clear(&w->astroids);
+
+   // init random astroids
+   if (w->swarm_size > 0)
+      return add_astroid_rpos(w, SWARM_SCALE, w->swarm_size);
+
+   int n = ASTROIDS_START > ASTROIDS_MAX ? ASTROIDS_MAX : ASTROIDS_START;
+   return add_astroid_rpos(w, ASTROIDS_SCALE, n);
+}
+
+/*
+ * a new game that only depends on seed. jobs starts out NULL, polygons
+ * come from the shared polygon pool so worlds get made on one thread.
+ */
+int world_init(struct world *w, unsigned int seed, int swarm_size)
+{
+   if (w == NULL)
+      return -1;
+
+   memset(w, 0, sizeof(*w));
+
+   w->rng = seed;
+   w->swarm_size = swarm_size;
+
+   // init player
+   w->player.ship = create_reg_polygon(3, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, 0, SHIP_SIZE);
+   w->player.thruster = create_reg_polygon(3, 0, 0, 0, (float)SHIP_SIZE / 2.0f);
+
+   if (w->player.ship == NULL || w->player.thruster == NULL)
+      return -1;
+
+   w->player.last_thruster = get_pose(w->player.thruster);
+
+   // init bullets and astroids
+   if (spatial_hash_init(&w->astroid_grid, SCREEN_WIDTH, SCREEN_HEIGHT, GRID_CELL_SIZE) != 0 ||
+       object_pool_init(&w->bullets, BULLET_SIDES, POOL_START_SIZE) != 0 ||
+       object_pool_init(&w->astroids, ASTROID_SIDES, POOL_START_SIZE) != 0 ||
+       init_outlines(w) != 0)
+      return -1;
+
+   return world_restart(w);
+}
+
+static void move_bullets_job(void *data, int worker, int begin, int end)
+{
+   (void)worker;
+
+   struct world *w = (struct world *)data;
+
+   for (int i = begin; i < end; i++)
+   {
+      w->bullets.x[i] += w->bullets.vx[i] * w->delta_t;
+      w->bullets.y[i] += w->bullets.vy[i] * w->delta_t;
+   }
+}
+
+// move, wrap and sync astroids in one pass
+static void move_astroids_job(void *data, int worker, int begin, int end)
+{
+   (void)worker;
+
+   struct object_pool *astroids = &((struct world *)data)->astroids;
+   double delta_t = ((struct world *)data)->delta_t;
+
+   for (int i = begin; i < end; i++)
+   {
+      astroids->x[i] += astroids->vx[i] * delta_t;
+      astroids->y[i] += astroids->vy[i] * delta_t;
+
+      // wrap astroids around screen
+      float moved_x = astroids->x[i];
+      float moved_y = astroids->y[i];
+
+      wrap_position(astroids->x[i], astroids->y[i], &astroids->x[i], &astroids->y[i]);
+      astroids->last_x[i] += astroids->x[i] - moved_x;
+      astroids->last_y[i] += astroids->y[i] - moved_y;
+   }
+
+   object_pool_sync_range(astroids, begin, end);
+}
+
+static void sync_job(void *data, int worker, int begin, int end)
+{
+   (void)worker;
+
+   object_pool_sync_range((struct object_pool *)data, begin, end);
+}
+
+static void rebuild_job(void *data, int worker, int begin, int end)
+{
+   (void)worker;
+
+   object_pool_update_range((struct object_pool *)data, begin, end);
+}
+
+/*
+ * astroid in ids bullet i ran into first on its way this step, -1 for
+ * none. the path is swept relative to each astroid so fast bullets and
+ * long steps can't jump over one. grid entries past the last astroid
+ * are left over from removes.
+ */
+static int first_hit(struct world *w, int i, const int *ids, int n)
+{
+   struct object_pool *astroids = &w->astroids;
+   struct object_pool *bullets = &w->bullets;
+
+   int hit = -1;
+   float first = INFINITY;
+
+   for (int k = 0; k < n; k++)
+   {
+      int j = ids[k];
+
+      if (j >= astroids->count)
+         continue;
+
+      // where the bullet started, seen from where the astroid is now
+      float x0 = bullets->last_x[i] + astroids->x[j] - astroids->last_x[j];
+      float y0 = bullets->last_y[i] + astroids->y[j] - astroids->last_y[j];
+      float t;
+
+      if (segment_polygon_collision(x0, y0, bullets->x[i], bullets->y[i], &astroids->shape[j], &t) && t < first)
+      {
+         hit = j;
+         first = t;
+      }
+   }
+
+   return hit;
+}
+
+// bullet (i) hit astroid (j)
+static void hit_astroid(struct world *w, int i, int j)
+{
+   float x = w->astroids.x[j];
+   float y = w->astroids.y[j];
+   float scale = (w->astroids.scale[j] - (w->astroids.scale[j] / 2.0f));
+
+   // remove bullet and astroid stuff
+   remove_bullet(w, i);
+   remove_astroid(w, j);
+
+   // astroid j and the last astroid changed, the new ones come after it
+   if (w->astroid_touched != NULL && j < w->max_astroid_touched)
+      w->astroid_touched[j] = 1;
+   if (w->astroids.count < w->touched_from)
+      w->touched_from = w->astroids.count;
+
+   // create two smaller astroids
+   if (scale >= ASTROIDS_SCALE / 4.0f)
+      add_astroid(w, x, y, scale, ASTROID_CHILDS);
+}
+
+static int is_touched(struct world *w, int j)
+{
+   return j >= w->touched_from || w->astroid_touched[j];
+}
+
+// make room for the hit buffers, -1 falls back to the serial loop
+static int reserve_hits(struct world *w)
+{
+   if (w->max_bullet_hits < w->bullets.count)
+   {
+      int *hits = (int *)realloc(w->bullet_hits, sizeof(int) * w->bullets.capacity);
+      if (hits == NULL)
+         return -1;
+      w->bullet_hits = hits;
+
+      int *origin = (int *)realloc(w->bullet_origin, sizeof(int) * w->bullets.capacity);
+      if (origin == NULL)
+         return -1;
+      w->bullet_origin = origin;
+
+      w->max_bullet_hits = w->bullets.capacity;
+   }
+
+   if (w->max_worker_candidates < w->astroids.capacity)
+   {
+      int *p = (int *)realloc(w->worker_candidates, sizeof(int) * nworkers(w) * w->astroids.capacity);
+      if (p == NULL)
+         return -1;
+
+      w->worker_candidates = p;
+      w->max_worker_candidates = w->astroids.capacity;
+   }
+
+   if (w->max_astroid_touched < w->astroids.capacity)
+   {
+      char *p = (char *)realloc(w->astroid_touched, w->astroids.capacity);
+      if (p == NULL)
+         return -1;
+
+      w->astroid_touched = p;
+      w->max_astroid_touched = w->astroids.capacity;
+   }
+
+   return 0;
+}
+
+// find the first astroid each bullet hits, nothing gets changed yet
+static void bullet_hits_job(void *data, int worker, int begin, int end)
+{
+   struct world *w = (struct world *)data;
+   int *ids = w->worker_candidates + worker * w->max_worker_candidates;
+
+   for (int i = begin; i < end; i++)
+   {
+      int n = spatial_hash_query_segment(&w->astroid_grid, w->bullets.last_x[i], w->bullets.last_y[i],
+            w->bullets.x[i], w->bullets.y[i], astroid_step(w), ids, w->max_worker_candidates);
+      w->bullet_hits[i] = first_hit(w, i, ids, n);
+   }
+}
+
+static void collide_bullets_parallel(struct world *w)
+{
+   job_parallel_for(w->jobs, w->bullets.count, JOB_CHUNK, bullet_hits_job, w);
+
+   for (int i = 0; i < w->bullets.count; i++)
+      w->bullet_origin[i] = i;
+
+   memset(w->astroid_touched, 0, w->max_astroid_touched);
+   w->touched_from = w->astroids.count;
+
+   int touched = 0;
+
+   for (int i = 0; i < w->bullets.count; )
+   {
+      int j = w->bullet_hits[w->bullet_origin[i]];
+
+      // the found hit still holds if none of the astroids near the bullet changed
+      if (touched)
+      {
+         int ncandidates = query_bullet_path(w, i);
+
+         for (int k = 0; k < ncandidates; k++)
+         {
+            if (is_touched(w, w->candidates[k]))
+            {
+               j = first_hit(w, i, w->candidates, ncandidates);
+               break;
+            }
+         }
+      }
+
+      if (j < 0)
+      {
+         i++;
+         continue;
+      }
+
+      // the last bullet moves into i
+      w->bullet_origin[i] = w->bullet_origin[w->bullets.count - 1];
+      hit_astroid(w, i, j);
+      touched = 1;
+   }
+}
+
+// one step of delta_t seconds with the keys in w->keypress
+void world_step(struct world *w, double delta_t)
+{
+   struct ship *player = &w->player;
+
+   w->delta_t = delta_t;
+
+   begin_phase(w, PROFILE_MOVE);
+
+   // where everything was, for drawing between this step and the last
+   player->last_ship = get_pose(player->ship);
+   player->last_thruster = get_pose(player->thruster);
+   object_pool_save(&w->bullets);
+   object_pool_save(&w->astroids);
+
+   /*
+    * player ship stuff
+    */
+
+   // acceleration controls
+   if (w->keypress[SDL_SCANCODE_W])
+   {
+      float s, c;
+      fast_sincosf(player->ship->angle, &s, &c);
+
+      // acceleration
+      player->velocity.x += c * (float)SHIP_SPEED * delta_t;
+      player->velocity.y += s * (float)SHIP_SPEED * delta_t;
+
+      /*
+       * note:
+       * I found this by accident but setting the thruster
+       * position before setting the player position gives a
+       * cool lag effect for the polygon giving a better
+       * feel for speed. This only works at lower fps.
+       */
+
+      // set thruster polygon stuff
+      polygon_set_angle(player->thruster, player->ship->angle + PI);
+      fast_sincosf(player->thruster->angle, &s, &c);
+      polygon_translate(player->thruster,
+            c * (float)SHIP_SIZE + player->ship->x,
+            s * (float)SHIP_SIZE + player->ship->y);
+
+      // it wasn't drawn last step so there is nothing to move from
+      if (!player->thrust)
+         player->last_thruster = get_pose(player->thruster);
+   }
+
+   player->thrust = w->keypress[SDL_SCANCODE_W];
+
+   // turn controls
+   if (w->keypress[SDL_SCANCODE_A])
+   {
+      polygon_set_angle(player->ship, player->ship->angle - (float)SHIP_TURN_SPEED * delta_t);
+   }
+
+   if (w->keypress[SDL_SCANCODE_D])
+   {
+      polygon_set_angle(player->ship, player->ship->angle + (float)SHIP_TURN_SPEED * delta_t);
+   }
+
+   // give player drag to simulate speed limit
+   player->velocity.x -= player->velocity.x * delta_t;
+   player->velocity.y -= player->velocity.y * delta_t;
+
+   // move ship
+   float ship_x = player->ship->x + player->velocity.x * delta_t;
+   float ship_y = player->ship->y + player->velocity.y * delta_t;
+
+   // wrap ship around screen
+   wrap_position(ship_x, ship_y, &ship_x, &ship_y);
+
+   polygon_translate(player->ship, ship_x, ship_y);
+
+   /*
+    * bullet stuff
+    */
+
+   // shoot bullet
+   if (w->keypress[SDL_SCANCODE_SPACE])
+   {
+      // set first avalible space in array for bullet
+      if (w->bullet_timer <= 0)
+      {
+         add_bullet(w);
+         w->bullet_timer = BULLET_INTERVAL;
+      }
+   }
+
+   // move all bullets, ones that left the screen can still hit on their way out
+   job_parallel_for(w->jobs, w->bullets.count, JOB_CHUNK, move_bullets_job, w);
+
+   // reduce timer
+   if (w->bullet_timer > 0) w->bullet_timer -= delta_t * 1000.0f;
+
+   /*
+    * astroids stuff
+    */
+
+   // move all astroids
+   job_parallel_for(w->jobs, w->astroids.count, JOB_CHUNK, move_astroids_job, w);
+   end_phase(w, PROFILE_MOVE);
+
+   /*
+    * collision detection
+    */
+
+   begin_phase(w, PROFILE_REBUILD);
+
+   // put astroids in grid so only nearby pairs get checked, ones that don't fit get removed
+   spatial_hash_clear(&w->astroid_grid);
+   for (int i = 0; i < w->astroids.count; )
+   {
+      if (grid_astroid(w, i) == 0)
+         i++;
+      else
+         object_pool_remove(&w->astroids, i);
+   }
+
+   // with workers the vertices get built up front so collisions only read astroids
+   if (nworkers(w) > 1)
+      job_parallel_for(w->jobs, w->astroids.count, JOB_CHUNK, rebuild_job, &w->astroids);
+
+   end_phase(w, PROFILE_REBUILD);
+
+   int ncandidates;
+
+   // check player astroid collision
+   begin_phase(w, PROFILE_COLLIDE_SHIP);
+   ncandidates = query_astroids(w, player->ship->x, player->ship->y, polygon_bounding_radius(player->ship));
+   for (int k = 0; k < ncandidates; k++)
+   {
+      int i = w->candidates[k];
+
+      if (i < w->astroids.count && polygon_polygon_collision(player->ship, &w->astroids.shape[i]))
+      {
+         // still checked so swarms cost the same
+         if (w->swarm_size > 0)
+            break;
+
+         world_restart(w);
+         break;
+      }
+   }
+
+   end_phase(w, PROFILE_COLLIDE_SHIP);
+
+   // check bullet astroid collision
+   begin_phase(w, PROFILE_COLLIDE_BULLETS);
+   if (nworkers(w) > 1 && reserve_hits(w) == 0)
+   {
+      collide_bullets_parallel(w);
+   }
+   else
+   {
+      for (int i = 0; i < w->bullets.count; )
+      {
+         /*
+          * astroids split by earlier bullets are added to the grid
+          * when they are created so they still get found here.
+          */
+         ncandidates = query_bullet_path(w, i);
+         int j = first_hit(w, i, w->candidates, ncandidates);
+
+         // a hit bullet got replaced by the last bullet so check index again
+         if (j < 0)
+            i++;
+         else
+            hit_astroid(w, i, j);
+      }
+   }
+
+   // remove bullets that reached edge of space, backwards so moved bullets were already checked
+   for (int i = w->bullets.count - 1; i >= 0; i--)
+   {
+      if (wrap_position(w->bullets.x[i], w->bullets.y[i], NULL, NULL))
+         remove_bullet(w, i);
+   }
+
+   job_parallel_for(w->jobs, w->bullets.count, JOB_CHUNK, sync_job, &w->bullets);
+
+   end_phase(w, PROFILE_COLLIDE_BULLETS);
+
+   // add more astroids if there are no more astroids
+   if (w->astroids.count == 0)
+   {
+      w->current_round++;
+      int n = w->current_round + ASTROIDS_START - 1 > ASTROIDS_MAX ? ASTROIDS_MAX : w->current_round + ASTROIDS_START - 1;
+      add_astroid_rpos(w, ASTROIDS_SCALE, n);
+   }
+
+   w->tick++;
+}
+
+struct world_batch_args
+{
+   struct world *worlds;
+   unsigned long ticks;
+   double delta_t;
+   world_input input;
+   void *data;
+};
+
+// each world runs all its ticks at once so it stays in the worker's cache
+static void world_batch_job(void *data, int worker, int begin, int end)
+{
+   (void)worker;
+
+   struct world_batch_args *args = (struct world_batch_args *)data;
+
+   for (int i = begin; i < end; i++)
+   {
+      struct world *w = &args->worlds[i];
+
+      for (unsigned long t = 0; t < args->ticks; t++)
+      {
+         if (args->input != NULL)
+            args->input(w, args->data);
+
+         world_step(w, args->delta_t);
+      }
+   }
+}
+
+/*
+ * step every world ticks times, the worlds are split over the workers
+ * of js. a world is only ever touched by one thread so input gets
+ * called from the workers, once before each step. the worlds need their
+ * own jobs to be NULL, a job system can't run a parallel for inside one.
+ */
+void world_batch(struct job_system *js, struct world *worlds, int count, unsigned long ticks, double delta_t, world_input input, void *data)
+{
+   struct world_batch_args args = { worlds, ticks, delta_t, input, data };
+
+   job_parallel_for(js, count, 1, world_batch_job, &args);
+}
+
+// frees what the world owns, not its job system
+void world_free(struct world *w)
+{
+   if (w == NULL)
+      return;
+
+   free_polygon(w->player.ship);
+   free_polygon(w->player.thruster);
+   spatial_hash_free(&w->astroid_grid);
+   object_pool_free(&w->astroids);
+   object_pool_free(&w->bullets);
+   free(w->candidates);
+   free(w->bullet_hits);
+   free(w->bullet_origin);
+   free(w->worker_candidates);
+   free(w->astroid_touched);
+
+   w->player.ship = NULL;
+   w->player.thruster = NULL;
+   w->candidates = NULL;
+   w->bullet_hits = NULL;
+   w->bullet_origin = NULL;
+   w->worker_candidates = NULL;
+   w->astroid_touched = NULL;
+}
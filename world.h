@@ -0,0 +1,133 @@
+/*
+ * Description:
+ * The game simulation. everything one game needs is kept in a world so
+ * any number of them can be stepped side by side
+ */
+
+#ifndef WORLD
+#define WORLD
+
+#include <SDL2/SDL.h>
+#include "primitives.h"
+#include "spatial-hash.h"
+#include "object-pool.h"
+#include "job-system.h"
+
+#define SCREEN_WIDTH    1000
+#define SCREEN_HEIGHT   1000
+
+#define POOL_START_SIZE 32
+#define GRID_CELL_SIZE  100
+
+#define SHIP_SIZE       20
+#define SHIP_SPEED      500
+#define SHIP_TURN_SPEED 5
+
+#define BULLET_SIDES    6
+#define BULLET_SIZE     2
+#define BULLET_SPEED    600
+#define BULLET_INTERVAL 500
+
+#define ASTROID_SIDES   24
+#define ASTROIDS_SIZE   50
+#define ASTROIDS_SPEED  200
+#define ASTROIDS_SCALE  4
+#define ASTROIDS_MAX    5
+#define ASTROID_CHILDS  2
+#define ASTROIDS_START  2
+#define ASTROID_SHAPES  64
+
+#define SWARM_SCALE     (ASTROIDS_SCALE / 4.0f)
+
+// objects per parallel for chunk
+#define JOB_CHUNK       256
+
+struct pose
+{
+   float x, y, angle;
+};
+
+struct ship
+{
+   polygon *ship;
+   polygon *thruster;
+   struct { float x, y; } velocity;
+
+   // poses before the last step, for drawing in between steps
+   struct pose last_ship;
+   struct pose last_thruster;
+   char thrust;
+};
+
+struct world
+{
+   struct ship player;
+   struct object_pool astroids;
+   struct object_pool bullets;
+   struct spatial_hash astroid_grid;
+
+   // outline every bullet shares, astroids pick one of ASTROID_SHAPES
+   int bullet_outline;
+
+   int bullet_timer;
+   int current_round;
+
+   /*
+    * astroids to start each game with for stress tests. swarms use the
+    * smallest astroids and the ship can't die so they don't get
+    * respawned every tick.
+    */
+   int swarm_size;
+
+   // keys held for the next step by SDL_Scancode, set by whoever plays the world
+   char keypress[SDL_NUM_SCANCODES];
+
+   // step being run and steps done
+   double delta_t;
+   unsigned long tick;
+
+   // state for rand_seeded, every spawn draws from it
+   unsigned int rng;
+
+   // time the phases of a step in the profiler, only one world at a time can
+   char profile;
+
+   // grid query results
+   int *candidates;
+   int max_candidates;
+
+   // splits the per object loops over worker threads, NULL runs them on the caller
+   struct job_system *jobs;
+
+   /*
+    * bullet hits get found in parallel against the astroids as they were
+    * before any hits, then applied one by one in bullet order. astroids
+    * an applied hit changed are touched, a bullet near one of them gets
+    * checked again so the result is the same as a serial loop.
+    */
+   int *bullet_hits;
+   int *bullet_origin;
+   int max_bullet_hits;
+
+   // a grid query buffer per worker
+   int *worker_candidates;
+   int max_worker_candidates;
+
+   // every astroid from touched_from up is touched too
+   char *astroid_touched;
+   int max_astroid_touched;
+   int touched_from;
+};
+
+// sets the keys of w before each of its steps in a batch
+typedef void (*world_input)(struct world *w, void *data);
+
+int world_init             (struct world *w, unsigned int seed, int swarm_size);
+int world_restart          (struct world *w);
+void world_step            (struct world *w, double delta_t);
+void world_batch           (struct job_system *js, struct world *worlds, int count, unsigned long ticks, double delta_t, world_input input, void *data);
+void world_free            (struct world *w);
+int wrap_position          (float x, float y, float *ox, float *oy);
+struct pose get_pose       (struct polygon *p);
+
+#endif